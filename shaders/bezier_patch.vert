@@ -0,0 +1,44 @@
+#version 130
+// Variant of phong.vert that evaluates the bicubic patch on the GPU.
+// The vertex buffer only holds a static (u,v) grid; editing the surface
+// just re-uploads the 16 control points.
+attribute vec2 aUV;
+
+uniform mat4 view;
+uniform mat4 projection;
+uniform vec3 controlPoints[16];
+
+varying vec3 FragPos;
+varying vec3 Normal;
+
+vec4 bernstein(float t) {
+    float s = 1.0 - t;
+    return vec4(s * s * s, 3.0 * s * s * t, 3.0 * s * t * t, t * t * t);
+}
+
+vec4 bernsteinDerivative(float t) {
+    float s = 1.0 - t;
+    return vec4(-3.0 * s * s, 3.0 * s * s - 6.0 * s * t, 6.0 * s * t - 3.0 * t * t, 3.0 * t * t);
+}
+
+void main() {
+    vec4 bu = bernstein(aUV.x), dbu = bernsteinDerivative(aUV.x);
+    vec4 bv = bernstein(aUV.y), dbv = bernsteinDerivative(aUV.y);
+
+    // Rows of the control net are curves in u; the four row points form a curve in v.
+    vec3 pos = vec3(0.0), dPdu = vec3(0.0), dPdv = vec3(0.0);
+    for (int i = 0; i < 4; ++i) {
+        vec3 rowPoint = bu.x * controlPoints[i * 4 + 0] + bu.y * controlPoints[i * 4 + 1]
+                      + bu.z * controlPoints[i * 4 + 2] + bu.w * controlPoints[i * 4 + 3];
+        vec3 rowTangent = dbu.x * controlPoints[i * 4 + 0] + dbu.y * controlPoints[i * 4 + 1]
+                        + dbu.z * controlPoints[i * 4 + 2] + dbu.w * controlPoints[i * 4 + 3];
+        pos += bv[i] * rowPoint;
+        dPdu += bv[i] * rowTangent;
+        dPdv += dbv[i] * rowPoint;
+    }
+
+    vec3 n = cross(dPdu, dPdv);
+    gl_Position = projection * view * vec4(pos, 1.0);
+    FragPos = pos;
+    Normal = dot(n, n) > 1e-12 ? n : vec3(0.0, 0.0, 1.0);
+}
@@ -0,0 +1,7 @@
+#version 400
+// Hardware tessellation path: every vertex is one control point, passed on unchanged.
+in vec3 aPos;
+
+void main() {
+    gl_Position = vec4(aPos, 1.0);
+}
@@ -1,6 +1,9 @@
 #version 130
-uniform vec3 pickingColor;
+// Writes the object's ID into the GL_R32UI picking attachment (0 is the background).
+uniform uint objectID;
+
+out uint pickID;
 
 void main() {
-    gl_FragColor = vec4(pickingColor, 1.0);
+    pickID = objectID;
 }
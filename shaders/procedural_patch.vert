@@ -3,6 +3,10 @@
 attribute vec3 aPos;
 attribute vec3 aNormal;
 attribute vec2 aTexCoords;
+// Geomorphing: where this vertex sits on the next-coarser LOD mesh. morph = 1 draws the mesh
+// as tessellated; meshes without LOD leave these attributes disabled and set morph to 1.
+attribute vec3 aMorphPos;
+attribute vec3 aMorphNormal;
 
 varying vec3 FragPos;
 varying vec3 Normal;
@@ -11,11 +15,17 @@ varying vec2 TexCoords;
 uniform mat4 model;
 uniform mat4 view;
 uniform mat4 projection;
+uniform float morph;
+// Packed meshes store positions as 0..1 within the patch's bounding box; float meshes use
+// offset 0 and scale 1.
+uniform vec3 positionOffset;
+uniform vec3 positionScale;
 
 void main()
 {
-    FragPos = vec3(model * vec4(aPos, 1.0));
-    Normal = mat3(model) * aNormal;
+    vec3 position = positionOffset + positionScale * aPos;
+    FragPos = vec3(model * vec4(mix(aMorphPos, position, morph), 1.0));
+    Normal = mat3(model) * mix(aMorphNormal, aNormal, morph);
     TexCoords = aTexCoords;
     gl_Position = projection * view * vec4(FragPos, 1.0);
 }
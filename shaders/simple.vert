@@ -1,6 +1,7 @@
 #version 130
 attribute vec3 aPos;
-attribute vec3 aColor; // For axes
+attribute vec3 aColor;
+attribute float aSize; // point size; ignored for lines
 
 uniform mat4 view;
 uniform mat4 projection;
@@ -9,5 +10,6 @@ varying vec3 vColor;
 
 void main() {
     gl_Position = projection * view * vec4(aPos, 1.0);
+    gl_PointSize = aSize;
     vColor = aColor;
 }
@@ -0,0 +1,239 @@
+// Headless micro-benchmark for the Bezier patch evaluators. Prints one JSON document:
+// per tessellation level, the cost of point evaluation, full-grid tessellation and normal
+// generation for each variant, the heap allocations one run makes, and how far each
+// variant strays from the de Casteljau reference.
+
+#include <glm/glm.hpp>
+
+#include <iostream>
+#include <vector>
+#include <string>
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+#include <new>
+#include <functional>
+#include <algorithm>
+
+#include "bezier_eval.h"
+#include "bezier_patch.h"
+#include "bezier_simd.h"
+
+using namespace std;
+using namespace glm;
+
+// --- Function Prototypes ---
+vec3 evaluateBezierCurvePow(const vec3& p0, const vec3& p1, const vec3& p2, const vec3& p3, float t);
+vec3 evaluateBezierPatchPow(const vec3* cp, float u, float v);
+template <int Degree> vector<vec3> makeControlNet();
+double timeRun(const function<void()>& run, size_t& allocations);
+void printTiming(const string& name, double seconds, size_t samples, size_t allocations, bool last);
+
+// --- Allocation Counting ---
+// Every global new in the process goes through here; a run's count is the difference
+// across it.
+size_t allocationCount = 0;
+
+void* operator new(size_t size) {
+    ++allocationCount;
+    if (void* p = malloc(size ? size : 1)) return p;
+    throw bad_alloc();
+}
+void operator delete(void* p) noexcept { free(p); }
+void operator delete(void* p, size_t) noexcept { free(p); }
+
+// --- Benchmark Setup ---
+// texture_mapping's patch; its default level is 150.
+const vec3 controlPoints[16] = {
+    vec3(-1.5, -1.5, -1.0), vec3(-0.5, -1.5, -1.0), vec3(0.5, -1.5, -1.0), vec3(1.5, -1.5, -1.0),
+    vec3(-1.5, -0.5, -1.0), vec3(-0.5,  0.5,  2.0), vec3(0.5,  0.5,  2.0), vec3(1.5, -0.5, -1.0),
+    vec3(-1.5,  0.5, -1.0), vec3(-0.5,  0.5,  2.0), vec3(0.5,  0.5,  2.0), vec3(1.5,  0.5, -1.0),
+    vec3(-1.5,  1.5, -1.0), vec3(-0.5,  1.5, -1.0), vec3(0.5,  1.5, -1.0), vec3(1.5,  1.5, -1.0)
+};
+const int levels[] = { 10, 50, 100, 150, 500, 1000 };
+const double minSecondsPerVariant = 0.2; // each variant repeats until it has run this long
+volatile float sink; // keeps results observable so the timed loops are not optimized out
+
+// Wavy control nets for the other degrees of the bezier_patch.h templates, and weights for
+// the rational cubic that pull its middle points in harder.
+const vector<vec3> quadraticNet = makeControlNet<2>(), quinticNet = makeControlNet<5>();
+const float rationalWeights[16] = { 1, 1, 1, 1, 1, 3, 3, 1, 1, 3, 3, 1, 1, 1, 1, 1 };
+const float unitWeights[16] = { 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1 };
+
+int main() {
+    cout << "{\n  \"simd\": \"" << kSimdName << "\",\n  \"levels\": [\n";
+    for (size_t li = 0; li < sizeof(levels) / sizeof(levels[0]); ++li) {
+        int n = levels[li];
+        size_t samples = (size_t)(n + 1) * (n + 1);
+        float step = 1.0f / n;
+        vector<vec3> reference(samples), referenceNormals(samples), grid(samples);
+        vector<float> simdGrid(samples * 6);
+        BezierPatchTessellator tessellator;
+        tessellator.setLevel(n);
+        size_t allocations;
+
+        cout << "    {\n      \"level\": " << n << ",\n      \"samples\": " << samples << ",\n";
+
+        // --- Point Evaluation ---
+        // One call per (u,v), results discarded into the sink.
+        cout << "      \"evaluate\": {\n";
+        double seconds = timeRun([&] {
+            float acc = 0.0f;
+            for (int i = 0; i <= n; ++i)
+                for (int j = 0; j <= n; ++j) acc += evaluateBezierPatch(controlPoints, i * step, j * step).z;
+            sink = acc;
+        }, allocations);
+        printTiming("de_casteljau", seconds, samples, allocations, false);
+        seconds = timeRun([&] {
+            float acc = 0.0f;
+            for (int i = 0; i <= n; ++i)
+                for (int j = 0; j <= n; ++j) acc += evaluateBezierPatchPow(controlPoints, i * step, j * step).z;
+            sink = acc;
+        }, allocations);
+        printTiming("pow_bernstein", seconds, samples, allocations, false);
+        seconds = timeRun([&] {
+            float acc = 0.0f;
+            for (int i = 0; i <= n; ++i)
+                for (int j = 0; j <= n; ++j) acc += BezierPatchEvaluator<2, 2, vec3>::evaluate(quadraticNet.data(), i * step, j * step).z;
+            sink = acc;
+        }, allocations);
+        printTiming("template_quadratic", seconds, samples, allocations, false);
+        seconds = timeRun([&] {
+            float acc = 0.0f;
+            for (int i = 0; i <= n; ++i)
+                for (int j = 0; j <= n; ++j) acc += BezierPatchEvaluator<5, 5, vec3>::evaluate(quinticNet.data(), i * step, j * step).z;
+            sink = acc;
+        }, allocations);
+        printTiming("template_quintic", seconds, samples, allocations, false);
+        seconds = timeRun([&] {
+            float acc = 0.0f;
+            for (int i = 0; i <= n; ++i)
+                for (int j = 0; j <= n; ++j) acc += BezierPatchEvaluator<5, 5, vec3>::evaluateBernstein(quinticNet.data(), i * step, j * step).z;
+            sink = acc;
+        }, allocations);
+        printTiming("template_quintic_bernstein", seconds, samples, allocations, false);
+        seconds = timeRun([&] {
+            float acc = 0.0f;
+            for (int i = 0; i <= n; ++i)
+                for (int j = 0; j <= n; ++j)
+                    acc += RationalBezierPatchEvaluator<3, 3, vec3>::evaluate(controlPoints, rationalWeights, i * step, j * step).z;
+            sink = acc;
+        }, allocations);
+        printTiming("template_rational_cubic", seconds, samples, allocations, true);
+        cout << "      },\n";
+
+        // --- Full-Grid Tessellation ---
+        // Positions for the whole (n+1)^2 grid into a pre-sized buffer. The SIMD tessellator
+        // always produces normals alongside, so its figure also covers normal generation.
+        cout << "      \"grid\": {\n";
+        seconds = timeRun([&] {
+            for (int i = 0; i <= n; ++i)
+                for (int j = 0; j <= n; ++j) reference[i * (n + 1) + j] = evaluateBezierPatch(controlPoints, i * step, j * step);
+        }, allocations);
+        printTiming("de_casteljau", seconds, samples, allocations, false);
+        seconds = timeRun([&] { tessellateGridForwardDiff(controlPoints, n, grid.data()); }, allocations);
+        printTiming("forward_diff", seconds, samples, allocations, false);
+        seconds = timeRun([&] {
+            tessellator.setControlPoints(controlPoints);
+            tessellator.tessellate(simdGrid.data(), 6);
+        }, allocations);
+        printTiming("simd_bernstein_with_normals", seconds, samples, allocations, true);
+        cout << "      },\n";
+
+        // --- Normal Generation ---
+        cout << "      \"normals\": {\n";
+        seconds = timeRun([&] {
+            for (int i = 0; i <= n; ++i)
+                for (int j = 0; j <= n; ++j) referenceNormals[i * (n + 1) + j] = evaluateBezierPatchNormal(controlPoints, i * step, j * step);
+        }, allocations);
+        printTiming("analytic_de_casteljau", seconds, samples, allocations, true);
+        cout << "      },\n";
+
+        // --- Deviation From de Casteljau ---
+        // Largest distance over the grid; normals are unit length, so theirs is a chord. The
+        // quintic Bernstein form is checked against quintic de Casteljau, and the rational cubic
+        // with unit weights against the plain cubic.
+        float powDeviation = 0.0f, forwardDiffDeviation = 0.0f, simdDeviation = 0.0f, simdNormalDeviation = 0.0f;
+        float quinticBernsteinDeviation = 0.0f, rationalDeviation = 0.0f;
+        for (int i = 0; i <= n; ++i) {
+            for (int j = 0; j <= n; ++j) {
+                size_t k = i * (n + 1) + j;
+                const float* s = &simdGrid[k * 6];
+                powDeviation = std::max(powDeviation, length(evaluateBezierPatchPow(controlPoints, i * step, j * step) - reference[k]));
+                forwardDiffDeviation = std::max(forwardDiffDeviation, length(grid[k] - reference[k]));
+                simdDeviation = std::max(simdDeviation, length(vec3(s[0], s[1], s[2]) - reference[k]));
+                simdNormalDeviation = std::max(simdNormalDeviation, length(vec3(s[3], s[4], s[5]) - referenceNormals[k]));
+                float u = i * step, v = j * step;
+                quinticBernsteinDeviation = std::max(quinticBernsteinDeviation,
+                    length(BezierPatchEvaluator<5, 5, vec3>::evaluateBernstein(quinticNet.data(), u, v) -
+                           BezierPatchEvaluator<5, 5, vec3>::evaluate(quinticNet.data(), u, v)));
+                rationalDeviation = std::max(rationalDeviation,
+                    length(RationalBezierPatchEvaluator<3, 3, vec3>::evaluate(controlPoints, unitWeights, u, v) - reference[k]));
+            }
+        }
+        cout << "      \"max_deviation\": {\n"
+             << "        \"pow_bernstein\": " << powDeviation << ",\n"
+             << "        \"forward_diff\": " << forwardDiffDeviation << ",\n"
+             << "        \"simd_bernstein\": " << simdDeviation << ",\n"
+             << "        \"simd_normals\": " << simdNormalDeviation << ",\n"
+             << "        \"template_quintic_bernstein\": " << quinticBernsteinDeviation << ",\n"
+             << "        \"template_rational_unit_weights\": " << rationalDeviation << "\n"
+             << "      }\n"
+             << "    }" << (li + 1 < sizeof(levels) / sizeof(levels[0]) ? "," : "") << "\n";
+    }
+    cout << "  ]\n}" << endl;
+    return 0;
+}
+
+// The evaluator texture_mapping used before the Bernstein-table tessellator, kept here as
+// the baseline: Bernstein weights through pow() on every call.
+vec3 evaluateBezierCurvePow(const vec3& p0, const vec3& p1, const vec3& p2, const vec3& p3, float t) {
+    float one_minus_t = 1.0f - t;
+    return pow(one_minus_t, 3.0f) * p0 + 3.0f * pow(one_minus_t, 2.0f) * t * p1 + 3.0f * one_minus_t * pow(t, 2.0f) * p2 + pow(t, 3.0f) * p3;
+}
+
+vec3 evaluateBezierPatchPow(const vec3* cp, float u, float v) {
+    vec3 v_curve_points[4];
+    for (int i = 0; i < 4; ++i) {
+        v_curve_points[i] = evaluateBezierCurvePow(cp[i * 4 + 0], cp[i * 4 + 1], cp[i * 4 + 2], cp[i * 4 + 3], u);
+    }
+    return evaluateBezierCurvePow(v_curve_points[0], v_curve_points[1], v_curve_points[2], v_curve_points[3], v);
+}
+
+// (Degree+1)^2 points on a 3x3 square in x/y with a sine wave in z.
+template <int Degree>
+vector<vec3> makeControlNet() {
+    vector<vec3> net;
+    for (int r = 0; r <= Degree; ++r) {
+        for (int k = 0; k <= Degree; ++k) {
+            float x = 3.0f * k / Degree - 1.5f, y = 3.0f * r / Degree - 1.5f;
+            net.push_back(vec3(x, y, sin(2.0f * x) * cos(2.0f * y)));
+        }
+    }
+    return net;
+}
+
+// Seconds per run, averaged over as many runs as fit in minSecondsPerVariant. The first run
+// is a warm-up and also the one whose heap allocations are reported.
+double timeRun(const function<void()>& run, size_t& allocations) {
+    size_t before = allocationCount;
+    run();
+    allocations = allocationCount - before;
+
+    using Clock = chrono::steady_clock;
+    int runs = 0;
+    Clock::time_point start = Clock::now();
+    double elapsed;
+    do {
+        run();
+        ++runs;
+        elapsed = chrono::duration<double>(Clock::now() - start).count();
+    } while (elapsed < minSecondsPerVariant);
+    return elapsed / runs;
+}
+
+void printTiming(const string& name, double seconds, size_t samples, size_t allocations, bool last) {
+    cout << "        \"" << name << "\": { \"ns_per_sample\": " << seconds * 1e9 / samples
+         << ", \"vertices_per_second\": " << samples / seconds
+         << ", \"allocations\": " << allocations << " }" << (last ? "" : ",") << "\n";
+}
@@ -0,0 +1,57 @@
+// Scalar bicubic Bezier evaluation: de Casteljau points and analytic normals at any (u,v)
+// (the bicubic case of bezier_patch.h), plus forward differencing for regular grids.
+//
+// Control points are 16 vec3 in row-major order (row i = points i*4..i*4+3); u runs along a
+// row and v across rows, the same convention as BezierPatchTessellator.
+#pragma once
+
+#include <glm/glm.hpp>
+
+#include "bezier_patch.h"
+
+inline glm::vec3 evaluateBezierPatch(const glm::vec3* cp, float u, float v) {
+    return BezierPatchEvaluator<3, 3, glm::vec3>::evaluate(cp, u, v);
+}
+
+// Normal from dP/du x dP/dv, matching the winding of the flat-shaded triangles.
+inline glm::vec3 evaluateBezierPatchNormal(const glm::vec3* cp, float u, float v) {
+    return patchNormal<3, 3>(cp, u, v);
+}
+
+// Converts a cubic Bezier segment to its value and first three forward differences for step h.
+inline void initForwardDifferences(const glm::vec3& p0, const glm::vec3& p1, const glm::vec3& p2, const glm::vec3& p3, float h,
+                                   glm::vec3& f, glm::vec3& d1, glm::vec3& d2, glm::vec3& d3) {
+    glm::vec3 a = -p0 + 3.0f * p1 - 3.0f * p2 + p3;
+    glm::vec3 b = 3.0f * p0 - 6.0f * p1 + 3.0f * p2;
+    glm::vec3 c = -3.0f * p0 + 3.0f * p1;
+    float h2 = h * h, h3 = h2 * h;
+    f = p0;
+    d1 = a * h3 + b * h2 + c * h;
+    d2 = 6.0f * a * h3 + 2.0f * b * h2;
+    d3 = 6.0f * a * h3;
+}
+
+// Writes the (n+1)x(n+1) grid of positions, grid[i * (n + 1) + j] = P(i/n, j/n), in one walk.
+// Each control row is stepped along u with forward differences, giving the four points of
+// the v-curve at u_i, which is then stepped along v the same way. Every grid point costs
+// three vector adds instead of a full de Casteljau evaluation.
+inline void tessellateGridForwardDiff(const glm::vec3* cp, int n, glm::vec3* grid) {
+    float h = 1.0f / n;
+    glm::vec3 row[4], rowD1[4], rowD2[4], rowD3[4];
+    for (int r = 0; r < 4; ++r) {
+        initForwardDifferences(cp[r * 4 + 0], cp[r * 4 + 1], cp[r * 4 + 2], cp[r * 4 + 3], h,
+                               row[r], rowD1[r], rowD2[r], rowD3[r]);
+    }
+
+    for (int i = 0; i <= n; ++i) {
+        glm::vec3 p, d1, d2, d3;
+        initForwardDifferences(row[0], row[1], row[2], row[3], h, p, d1, d2, d3);
+        for (int j = 0; j <= n; ++j) {
+            grid[i * (n + 1) + j] = p;
+            p += d1; d1 += d2; d2 += d3;
+        }
+        for (int r = 0; r < 4; ++r) {
+            row[r] += rowD1[r]; rowD1[r] += rowD2[r]; rowD2[r] += rowD3[r];
+        }
+    }
+}
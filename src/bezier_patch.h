@@ -0,0 +1,191 @@
+// Compile-time specialized tensor-product Bezier patch evaluators.
+//
+// BezierPatchEvaluator<DegreeU, DegreeV, Point> evaluates a patch of any degree over any
+// point type with +, - and * float (glm::vec2/3/4, or Homogeneous below). The degrees are
+// template arguments, so every de Casteljau level and every row is unrolled at compile time
+// and the kernels have no loops or branches left. Bernstein weights come from constexpr
+// binomial coefficients and repeated products, never pow().
+//
+// RationalBezierPatchEvaluator adds a weight per control point (one NURBS segment). It runs
+// the same kernels on homogeneous points and divides at the end.
+//
+// Control points are (DegreeV + 1) rows of (DegreeU + 1) points, row-major; u runs along a
+// row and v across rows, the same convention as bezier_eval.h and BezierPatchTessellator.
+#pragma once
+
+#include <glm/glm.hpp>
+#include <cstddef>
+#include <utility>
+
+// The kernels are small but nest several levels deep, more than -O2 inlines on its own.
+#if defined(__GNUC__)
+#define BEZIER_INLINE inline __attribute__((always_inline))
+#elif defined(_MSC_VER)
+#define BEZIER_INLINE __forceinline
+#else
+#define BEZIER_INLINE inline
+#endif
+
+constexpr float binomialCoefficient(int n, int k) {
+    float c = 1.0f;
+    for (int i = 1; i <= k; ++i) c = c * (n - k + i) / i;
+    return c;
+}
+
+// Calls f(std::integral_constant<int, I>) for I = 0..N-1, expanded at compile time.
+template <typename F, std::size_t... I>
+BEZIER_INLINE void unrollLoopImpl(F&& f, std::index_sequence<I...>) {
+    (f(std::integral_constant<int, (int)I>()), ...);
+}
+template <int N, typename F>
+BEZIER_INLINE void unrollLoop(F&& f) {
+    unrollLoopImpl(f, std::make_index_sequence<N>());
+}
+
+// Degree-n curve at t: n levels of pairwise lerps, written as p * (1 - t) + q * t like
+// glm::mix so bicubic results match the mix-based evaluator bit for bit.
+template <int Degree, typename Point>
+BEZIER_INLINE Point deCasteljau(const Point* p, float t) {
+    if constexpr (Degree == 0) {
+        return p[0];
+    } else {
+        Point q[Degree];
+        unrollLoop<Degree>([&](auto i) { q[i] = p[i] * (1.0f - t) + p[i + 1] * t; });
+        return deCasteljau<Degree - 1>(q, t);
+    }
+}
+
+// Hodograph: Degree * (p[i+1] - p[i]) is a degree-1-lower curve.
+template <int Degree, typename Point>
+BEZIER_INLINE Point deCasteljauDerivative(const Point* p, float t) {
+    if constexpr (Degree == 0) {
+        return p[0] * 0.0f;
+    } else {
+        Point d[Degree];
+        unrollLoop<Degree>([&](auto i) { d[i] = (p[i + 1] - p[i]) * (float)Degree; });
+        return deCasteljau<Degree - 1>(d, t);
+    }
+}
+
+// B_{i,Degree}(t) for i = 0..Degree.
+template <int Degree>
+BEZIER_INLINE void bernsteinWeights(float t, float* weights) {
+    float s = 1.0f - t, tPow[Degree + 1], sPow[Degree + 1];
+    tPow[0] = sPow[0] = 1.0f;
+    unrollLoop<Degree>([&](auto i) { tPow[i + 1] = tPow[i] * t; sPow[i + 1] = sPow[i] * s; });
+    unrollLoop<Degree + 1>([&](auto i) {
+        constexpr float c = binomialCoefficient(Degree, decltype(i)::value);
+        weights[i] = c * tPow[i] * sPow[Degree - i];
+    });
+}
+
+template <int DegreeU, int DegreeV, typename Point>
+struct BezierPatchEvaluator {
+    static constexpr int kPointsU = DegreeU + 1, kPointsV = DegreeV + 1;
+    static constexpr int kControlPoints = kPointsU * kPointsV;
+
+    BEZIER_INLINE static Point evaluate(const Point* cp, float u, float v) {
+        Point rows[kPointsV];
+        unrollLoop<kPointsV>([&](auto r) { rows[r] = deCasteljau<DegreeU>(cp + r * kPointsU, u); });
+        return deCasteljau<DegreeV>(rows, v);
+    }
+
+    BEZIER_INLINE static Point derivativeU(const Point* cp, float u, float v) {
+        Point rows[kPointsV];
+        unrollLoop<kPointsV>([&](auto r) { rows[r] = deCasteljauDerivative<DegreeU>(cp + r * kPointsU, u); });
+        return deCasteljau<DegreeV>(rows, v);
+    }
+
+    BEZIER_INLINE static Point derivativeV(const Point* cp, float u, float v) {
+        Point rows[kPointsV];
+        unrollLoop<kPointsV>([&](auto r) { rows[r] = deCasteljau<DegreeU>(cp + r * kPointsU, u); });
+        return deCasteljauDerivative<DegreeV>(rows, v);
+    }
+
+    // Sum of B_i(u) B_j(v) P_ij: the same surface as evaluate(), a better fit when the same
+    // (u,v) weights are reused across many control nets.
+    BEZIER_INLINE static Point evaluateBernstein(const Point* cp, float u, float v) {
+        float bu[kPointsU], bv[kPointsV];
+        bernsteinWeights<DegreeU>(u, bu);
+        bernsteinWeights<DegreeV>(v, bv);
+        Point sum = cp[0] * 0.0f;
+        unrollLoop<kPointsV>([&](auto r) {
+            Point row = cp[r * kPointsU] * bu[0];
+            unrollLoop<DegreeU>([&](auto k) { row = row + cp[r * kPointsU + k + 1] * bu[k + 1]; });
+            sum = sum + row * bv[r];
+        });
+        return sum;
+    }
+};
+
+// Weighted point in homogeneous form (w * P, w).
+template <typename Point>
+struct Homogeneous {
+    Point wp;
+    float w;
+};
+template <typename Point>
+inline Homogeneous<Point> operator+(const Homogeneous<Point>& a, const Homogeneous<Point>& b) { return { a.wp + b.wp, a.w + b.w }; }
+template <typename Point>
+inline Homogeneous<Point> operator-(const Homogeneous<Point>& a, const Homogeneous<Point>& b) { return { a.wp - b.wp, a.w - b.w }; }
+template <typename Point>
+inline Homogeneous<Point> operator*(const Homogeneous<Point>& a, float s) { return { a.wp * s, a.w * s }; }
+
+template <int DegreeU, int DegreeV, typename Point>
+struct RationalBezierPatchEvaluator {
+    typedef BezierPatchEvaluator<DegreeU, DegreeV, Homogeneous<Point>> Lifted;
+    static constexpr int kControlPoints = Lifted::kControlPoints;
+
+    BEZIER_INLINE static Point evaluate(const Point* cp, const float* weights, float u, float v) {
+        Homogeneous<Point> h[kControlPoints];
+        lift(cp, weights, h);
+        Homogeneous<Point> p = Lifted::evaluate(h, u, v);
+        return p.wp / p.w;
+    }
+
+    // Quotient rule on the homogeneous surface: S' = (H'.wp - S * H'.w) / H.w.
+    BEZIER_INLINE static void evaluateWithDerivatives(const Point* cp, const float* weights, float u, float v,
+                                        Point& position, Point& dPdu, Point& dPdv) {
+        Homogeneous<Point> h[kControlPoints];
+        lift(cp, weights, h);
+        Homogeneous<Point> p = Lifted::evaluate(h, u, v);
+        Homogeneous<Point> du = Lifted::derivativeU(h, u, v);
+        Homogeneous<Point> dv = Lifted::derivativeV(h, u, v);
+        position = p.wp / p.w;
+        dPdu = (du.wp - position * du.w) / p.w;
+        dPdv = (dv.wp - position * dv.w) / p.w;
+    }
+
+private:
+    BEZIER_INLINE static void lift(const Point* cp, const float* weights, Homogeneous<Point>* h) {
+        unrollLoop<kControlPoints>([&](auto i) { h[i] = { cp[i] * weights[i], weights[i] }; });
+    }
+};
+
+// Unit normal dP/du x dP/dv, stepping slightly inwards where a collapsed edge makes a
+// derivative vanish, with +Z as the last resort.
+template <int DegreeU, int DegreeV>
+inline glm::vec3 patchNormal(const glm::vec3* cp, float u, float v) {
+    typedef BezierPatchEvaluator<DegreeU, DegreeV, glm::vec3> Patch;
+    for (int attempt = 0; attempt < 4; ++attempt) {
+        glm::vec3 n = glm::cross(Patch::derivativeU(cp, u, v), Patch::derivativeV(cp, u, v));
+        if (glm::length(n) > 1e-6f) return glm::normalize(n);
+        u = glm::mix(u, 0.5f, 0.01f);
+        v = glm::mix(v, 0.5f, 0.01f);
+    }
+    return glm::vec3(0.0f, 0.0f, 1.0f);
+}
+
+template <int DegreeU, int DegreeV>
+inline glm::vec3 rationalPatchNormal(const glm::vec3* cp, const float* weights, float u, float v) {
+    typedef RationalBezierPatchEvaluator<DegreeU, DegreeV, glm::vec3> Patch;
+    for (int attempt = 0; attempt < 4; ++attempt) {
+        glm::vec3 p, dPdu, dPdv;
+        Patch::evaluateWithDerivatives(cp, weights, u, v, p, dPdu, dPdv);
+        glm::vec3 n = glm::cross(dPdu, dPdv);
+        if (glm::length(n) > 1e-6f) return glm::normalize(n);
+        u = glm::mix(u, 0.5f, 0.01f);
+        v = glm::mix(v, 0.5f, 0.01f);
+    }
+    return glm::vec3(0.0f, 0.0f, 1.0f);
+}
@@ -0,0 +1,223 @@
+// Bicubic Bezier patch tessellator built on cached Bernstein tables.
+//
+// The weights B0..B3(t) and their derivatives are computed once per tessellation
+// level. Control points are kept in structure-of-arrays form, and every row of the
+// (u,v) grid is evaluated several samples at a time with NEON (aarch64), AVX or SSE,
+// falling back to plain scalar code elsewhere.
+#pragma once
+
+#include <glm/glm.hpp>
+#include <vector>
+#include <cmath>
+
+#if defined(__AVX__)
+#include <immintrin.h>
+#elif defined(__SSE2__)
+#include <emmintrin.h>
+#elif defined(__ARM_NEON) && defined(__aarch64__)
+#include <arm_neon.h>
+#endif
+
+// --- SIMD Abstraction ---
+// simdMadd(a, b, c) = a * b + c, fused where the target has it.
+#if defined(__AVX__)
+typedef __m256 simd_f;
+const int kSimdWidth = 8;
+const char* const kSimdName = "AVX";
+inline simd_f simdLoad(const float* p) { return _mm256_loadu_ps(p); }
+inline void simdStore(float* p, simd_f a) { _mm256_storeu_ps(p, a); }
+inline simd_f simdSet1(float s) { return _mm256_set1_ps(s); }
+inline simd_f simdAdd(simd_f a, simd_f b) { return _mm256_add_ps(a, b); }
+inline simd_f simdSub(simd_f a, simd_f b) { return _mm256_sub_ps(a, b); }
+inline simd_f simdMul(simd_f a, simd_f b) { return _mm256_mul_ps(a, b); }
+inline simd_f simdMax(simd_f a, simd_f b) { return _mm256_max_ps(a, b); }
+inline simd_f simdSqrt(simd_f a) { return _mm256_sqrt_ps(a); }
+inline simd_f simdDiv(simd_f a, simd_f b) { return _mm256_div_ps(a, b); }
+#if defined(__FMA__)
+inline simd_f simdMadd(simd_f a, simd_f b, simd_f c) { return _mm256_fmadd_ps(a, b, c); }
+#else
+inline simd_f simdMadd(simd_f a, simd_f b, simd_f c) { return _mm256_add_ps(_mm256_mul_ps(a, b), c); }
+#endif
+#elif defined(__SSE2__)
+typedef __m128 simd_f;
+const int kSimdWidth = 4;
+const char* const kSimdName = "SSE2";
+inline simd_f simdLoad(const float* p) { return _mm_loadu_ps(p); }
+inline void simdStore(float* p, simd_f a) { _mm_storeu_ps(p, a); }
+inline simd_f simdSet1(float s) { return _mm_set1_ps(s); }
+inline simd_f simdAdd(simd_f a, simd_f b) { return _mm_add_ps(a, b); }
+inline simd_f simdSub(simd_f a, simd_f b) { return _mm_sub_ps(a, b); }
+inline simd_f simdMul(simd_f a, simd_f b) { return _mm_mul_ps(a, b); }
+inline simd_f simdMax(simd_f a, simd_f b) { return _mm_max_ps(a, b); }
+inline simd_f simdSqrt(simd_f a) { return _mm_sqrt_ps(a); }
+inline simd_f simdDiv(simd_f a, simd_f b) { return _mm_div_ps(a, b); }
+inline simd_f simdMadd(simd_f a, simd_f b, simd_f c) { return _mm_add_ps(_mm_mul_ps(a, b), c); }
+#elif defined(__ARM_NEON) && defined(__aarch64__)
+typedef float32x4_t simd_f;
+const int kSimdWidth = 4;
+const char* const kSimdName = "NEON";
+inline simd_f simdLoad(const float* p) { return vld1q_f32(p); }
+inline void simdStore(float* p, simd_f a) { vst1q_f32(p, a); }
+inline simd_f simdSet1(float s) { return vdupq_n_f32(s); }
+inline simd_f simdAdd(simd_f a, simd_f b) { return vaddq_f32(a, b); }
+inline simd_f simdSub(simd_f a, simd_f b) { return vsubq_f32(a, b); }
+inline simd_f simdMul(simd_f a, simd_f b) { return vmulq_f32(a, b); }
+inline simd_f simdMax(simd_f a, simd_f b) { return vmaxq_f32(a, b); }
+inline simd_f simdSqrt(simd_f a) { return vsqrtq_f32(a); }
+inline simd_f simdDiv(simd_f a, simd_f b) { return vdivq_f32(a, b); }
+inline simd_f simdMadd(simd_f a, simd_f b, simd_f c) { return vfmaq_f32(c, a, b); }
+#else
+typedef float simd_f;
+const int kSimdWidth = 1;
+const char* const kSimdName = "scalar";
+inline simd_f simdLoad(const float* p) { return *p; }
+inline void simdStore(float* p, simd_f a) { *p = a; }
+inline simd_f simdSet1(float s) { return s; }
+inline simd_f simdAdd(simd_f a, simd_f b) { return a + b; }
+inline simd_f simdSub(simd_f a, simd_f b) { return a - b; }
+inline simd_f simdMul(simd_f a, simd_f b) { return a * b; }
+inline simd_f simdMax(simd_f a, simd_f b) { return a > b ? a : b; }
+inline simd_f simdSqrt(simd_f a) { return std::sqrt(a); }
+inline simd_f simdDiv(simd_f a, simd_f b) { return a / b; }
+inline simd_f simdMadd(simd_f a, simd_f b, simd_f c) { return a * b + c; }
+#endif
+
+// --- Tessellator ---
+class BezierPatchTessellator {
+public:
+    // Rebuilds the Bernstein tables only when the level actually changes.
+    void setLevel(int level) {
+        if (level == n) return;
+        n = level;
+        padded = ((n + 1 + kSimdWidth - 1) / kSimdWidth) * kSimdWidth;
+        float step = 1.0f / (float)n;
+        params.assign(padded, 0.0f);
+        for (int k = 0; k < 4; ++k) { basis[k].assign(padded, 0.0f); basisDeriv[k].assign(padded, 0.0f); }
+        for (int j = 0; j <= n; ++j) {
+            float t = (float)j * step, s = 1.0f - t;
+            params[j] = t;
+            basis[0][j] = s * s * s;
+            basis[1][j] = 3.0f * s * s * t;
+            basis[2][j] = 3.0f * s * t * t;
+            basis[3][j] = t * t * t;
+            basisDeriv[0][j] = -3.0f * s * s;
+            basisDeriv[1][j] = 3.0f * s * s - 6.0f * s * t;
+            basisDeriv[2][j] = 6.0f * s * t - 3.0f * t * t;
+            basisDeriv[3][j] = 3.0f * t * t;
+        }
+    }
+
+    // Takes the 16 control points in the demos' row-major order (row i = points i*4..i*4+3).
+    void setControlPoints(const glm::vec3* points) {
+        for (int k = 0; k < 16; ++k) { cx[k] = points[k].x; cy[k] = points[k].y; cz[k] = points[k].z; }
+    }
+
+    int level() const { return n; }
+
+    // Writes the full (level+1)^2 grid, row by row, as position, normal and (if
+    // floatsPerVertex >= 8) texture coordinates.
+    void tessellate(float* out, int floatsPerVertex) const {
+        tessellateRows(out, floatsPerVertex, 0, n + 1);
+    }
+
+    // Same layout, but only grid rows [rowBegin, rowEnd). Touches no shared mutable state,
+    // so disjoint row bands can be written into one pre-sized buffer from several threads.
+    // The row scratch is per thread and only grows, so the pool's long-lived workers stop
+    // allocating once they have seen the largest level.
+    void tessellateRows(float* out, int floatsPerVertex, int rowBegin, int rowEnd) const {
+        thread_local std::vector<float> row;
+        if (row.size() < (size_t)6 * padded) row.resize((size_t)6 * padded);
+        const float *px = &row[0], *py = px + padded, *pz = py + padded;
+        const float *nx = pz + padded, *ny = nx + padded, *nz = ny + padded;
+        for (int i = rowBegin; i < rowEnd; ++i) {
+            evaluateRow(i, row.data());
+            for (int j = 0; j <= n; ++j) {
+                float* vtx = out + (size_t)(i * (n + 1) + j) * floatsPerVertex;
+                vtx[0] = px[j]; vtx[1] = py[j]; vtx[2] = pz[j];
+                if (nx[j] * nx[j] + ny[j] * ny[j] + nz[j] * nz[j] < 0.25f) {
+                    glm::vec3 fix = degenerateNormal(params[i], params[j]);
+                    vtx[3] = fix.x; vtx[4] = fix.y; vtx[5] = fix.z;
+                } else {
+                    vtx[3] = nx[j]; vtx[4] = ny[j]; vtx[5] = nz[j];
+                }
+                if (floatsPerVertex >= 8) { vtx[6] = params[i]; vtx[7] = params[j]; }
+            }
+        }
+    }
+
+private:
+    // Evaluates positions and unit normals for u = i / level into six SoA arrays of
+    // `padded` floats each (px, py, pz, nx, ny, nz) starting at row.
+    void evaluateRow(int i, float* row) const {
+        float *px = row, *py = px + padded, *pz = py + padded;
+        float *nx = pz + padded, *ny = nx + padded, *nz = ny + padded;
+        // Collapse each control row to its point and u-tangent at u_i; v then runs over the row.
+        float qx[4], qy[4], qz[4], tx[4], ty[4], tz[4];
+        for (int r = 0; r < 4; ++r) {
+            qx[r] = qy[r] = qz[r] = tx[r] = ty[r] = tz[r] = 0.0f;
+            for (int k = 0; k < 4; ++k) {
+                float b = basis[k][i], d = basisDeriv[k][i];
+                qx[r] += b * cx[r * 4 + k]; qy[r] += b * cy[r * 4 + k]; qz[r] += b * cz[r * 4 + k];
+                tx[r] += d * cx[r * 4 + k]; ty[r] += d * cy[r * 4 + k]; tz[r] += d * cz[r * 4 + k];
+            }
+        }
+        simd_f Qx[4], Qy[4], Qz[4], Tx[4], Ty[4], Tz[4];
+        for (int r = 0; r < 4; ++r) {
+            Qx[r] = simdSet1(qx[r]); Qy[r] = simdSet1(qy[r]); Qz[r] = simdSet1(qz[r]);
+            Tx[r] = simdSet1(tx[r]); Ty[r] = simdSet1(ty[r]); Tz[r] = simdSet1(tz[r]);
+        }
+        const simd_f tiny = simdSet1(1e-24f);
+
+        for (int j = 0; j < padded; j += kSimdWidth) {
+            simd_f b[4], d[4];
+            for (int r = 0; r < 4; ++r) { b[r] = simdLoad(&basis[r][j]); d[r] = simdLoad(&basisDeriv[r][j]); }
+
+            simd_f x = simdMul(b[0], Qx[0]), y = simdMul(b[0], Qy[0]), z = simdMul(b[0], Qz[0]);
+            simd_f ux = simdMul(b[0], Tx[0]), uy = simdMul(b[0], Ty[0]), uz = simdMul(b[0], Tz[0]);
+            simd_f vx = simdMul(d[0], Qx[0]), vy = simdMul(d[0], Qy[0]), vz = simdMul(d[0], Qz[0]);
+            for (int r = 1; r < 4; ++r) {
+                x = simdMadd(b[r], Qx[r], x); y = simdMadd(b[r], Qy[r], y); z = simdMadd(b[r], Qz[r], z);
+                ux = simdMadd(b[r], Tx[r], ux); uy = simdMadd(b[r], Ty[r], uy); uz = simdMadd(b[r], Tz[r], uz);
+                vx = simdMadd(d[r], Qx[r], vx); vy = simdMadd(d[r], Qy[r], vy); vz = simdMadd(d[r], Qz[r], vz);
+            }
+
+            // n = normalize(dP/du x dP/dv)
+            simd_f cxr = simdSub(simdMul(uy, vz), simdMul(uz, vy));
+            simd_f cyr = simdSub(simdMul(uz, vx), simdMul(ux, vz));
+            simd_f czr = simdSub(simdMul(ux, vy), simdMul(uy, vx));
+            simd_f len2 = simdMadd(cxr, cxr, simdMadd(cyr, cyr, simdMul(czr, czr)));
+            simd_f len = simdSqrt(simdMax(len2, tiny));
+
+            simdStore(&px[j], x); simdStore(&py[j], y); simdStore(&pz[j], z);
+            simdStore(&nx[j], simdDiv(cxr, len)); simdStore(&ny[j], simdDiv(cyr, len)); simdStore(&nz[j], simdDiv(czr, len));
+        }
+    }
+
+    // Coincident control points make a derivative vanish; step towards the centre until it doesn't.
+    glm::vec3 degenerateNormal(float u, float v) const {
+        for (int attempt = 0; attempt < 4; ++attempt) {
+            u += (0.5f - u) * 0.01f; v += (0.5f - v) * 0.01f;
+            float su = 1.0f - u, sv = 1.0f - v;
+            float bu[4] = { su * su * su, 3.0f * su * su * u, 3.0f * su * u * u, u * u * u };
+            float du[4] = { -3.0f * su * su, 3.0f * su * su - 6.0f * su * u, 6.0f * su * u - 3.0f * u * u, 3.0f * u * u };
+            float bv[4] = { sv * sv * sv, 3.0f * sv * sv * v, 3.0f * sv * v * v, v * v * v };
+            float dv[4] = { -3.0f * sv * sv, 3.0f * sv * sv - 6.0f * sv * v, 6.0f * sv * v - 3.0f * v * v, 3.0f * v * v };
+            glm::vec3 dPdu(0.0f), dPdv(0.0f);
+            for (int r = 0; r < 4; ++r) {
+                for (int k = 0; k < 4; ++k) {
+                    glm::vec3 p(cx[r * 4 + k], cy[r * 4 + k], cz[r * 4 + k]);
+                    dPdu += bv[r] * du[k] * p;
+                    dPdv += dv[r] * bu[k] * p;
+                }
+            }
+            glm::vec3 c = glm::cross(dPdu, dPdv);
+            if (glm::length(c) > 1e-6f) return glm::normalize(c);
+        }
+        return glm::vec3(0.0f, 0.0f, 1.0f);
+    }
+
+    int n = 0, padded = 0;
+    std::vector<float> params;                        // t_j = j / level
+    std::vector<float> basis[4], basisDeriv[4];       // B_k(t_j) and B_k'(t_j), zero-padded to kSimdWidth
+    float cx[16] = {}, cy[16] = {}, cz[16] = {};      // control points, structure-of-arrays
+};
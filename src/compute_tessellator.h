@@ -0,0 +1,105 @@
+// Batch tessellation of many bicubic patches in one GL 4.3 compute dispatch.
+//
+// The welded control points live in one shader storage buffer, and each patch is described by
+// a ComputePatchRecord: its 16 control-point indices, its own level, and the first of its
+// (level+1)^2 vertices in the output. bezier_patch.comp runs one invocation per output vertex
+// and writes position, analytic normal and (u,v) straight into the caller's vertex buffer,
+// in the same order and 8-float layout as BezierPatchTessellator::tessellate(out, 8), so
+// either path can fill the same buffer and index list.
+//
+// glad is generated for GL 3.3, so glDispatchCompute, glMemoryBarrier and the enums are
+// provided here. Without GL 4.3 (or ARB_compute_shader plus ARB_shader_storage_buffer_object)
+// init() returns false and the demo keeps its CPU tessellator.
+#pragma once
+
+#include <glad/glad.h>
+#include <GLFW/glfw3.h>
+#include <glm/glm.hpp>
+
+#include <cstddef>
+
+#ifndef GL_COMPUTE_SHADER
+#define GL_COMPUTE_SHADER 0x91B9
+#endif
+#ifndef GL_SHADER_STORAGE_BUFFER
+#define GL_SHADER_STORAGE_BUFFER 0x90D2
+#endif
+#ifndef GL_VERTEX_ATTRIB_ARRAY_BARRIER_BIT
+#define GL_VERTEX_ATTRIB_ARRAY_BARRIER_BIT 0x00000001
+#endif
+#ifndef GL_BUFFER_UPDATE_BARRIER_BIT
+#define GL_BUFFER_UPDATE_BARRIER_BIT 0x00000200
+#endif
+
+// Matches the std430 PatchRecord in bezier_patch.comp (72 bytes, no padding).
+struct ComputePatchRecord {
+    GLint controlIndices[16];
+    GLint level;
+    GLint firstVertex;
+};
+
+class ComputePatchTessellator {
+public:
+    static const int kFloatsPerVertex = 8;
+    static const int kGroupSize = 64;   // local_size_x in bezier_patch.comp
+
+    // Needs a current context.
+    bool init() {
+        bool supported = GLVersion.major > 4 || (GLVersion.major == 4 && GLVersion.minor >= 3) ||
+                         (glfwExtensionSupported("GL_ARB_compute_shader") && glfwExtensionSupported("GL_ARB_shader_storage_buffer_object"));
+        if (supported) {
+            dispatchCompute = (DispatchComputeProc)glfwGetProcAddress("glDispatchCompute");
+            memoryBarrier = (MemoryBarrierProc)glfwGetProcAddress("glMemoryBarrier");
+        }
+        if (!dispatchCompute || !memoryBarrier) return false;
+        glGenBuffers(1, &pointBuffer);
+        glGenBuffers(1, &recordBuffer);
+        return true;
+    }
+
+    bool available() const { return program != 0; }
+
+    // Program linked from bezier_patch.comp; 0 (a failed link) leaves the tessellator unavailable.
+    void setProgram(GLuint computeProgram) { program = computeProgram; }
+
+    // Reallocates only when the point count changes.
+    void setControlPoints(const glm::vec3* points, size_t pointCount) {
+        glBindBuffer(GL_SHADER_STORAGE_BUFFER, pointBuffer);
+        if (pointCount != capacity) {
+            glBufferData(GL_SHADER_STORAGE_BUFFER, pointCount * sizeof(glm::vec3), points, GL_DYNAMIC_DRAW);
+            capacity = pointCount;
+        } else {
+            glBufferSubData(GL_SHADER_STORAGE_BUFFER, 0, pointCount * sizeof(glm::vec3), points);
+        }
+    }
+
+    // Evaluates the listed patches into vertexBuffer, which the caller has sized to hold every
+    // record's vertex range. One work group row per patch; invocations past a patch's last
+    // vertex exit. The barrier orders the writes before the next vertex fetch and before a
+    // later glBufferSubData into the same buffer (the CPU path, after E).
+    void tessellate(const ComputePatchRecord* records, size_t recordCount, GLuint vertexBuffer) {
+        if (recordCount == 0) return;
+        int maxVertices = 0;
+        for (size_t p = 0; p < recordCount; ++p) {
+            int side = records[p].level + 1;
+            if (side * side > maxVertices) maxVertices = side * side;
+        }
+        glBindBuffer(GL_SHADER_STORAGE_BUFFER, recordBuffer);
+        glBufferData(GL_SHADER_STORAGE_BUFFER, recordCount * sizeof(ComputePatchRecord), records, GL_STREAM_DRAW);
+        glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 0, pointBuffer);
+        glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 1, recordBuffer);
+        glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 2, vertexBuffer);
+        glUseProgram(program);
+        dispatchCompute((maxVertices + kGroupSize - 1) / kGroupSize, (GLuint)recordCount, 1);
+        memoryBarrier(GL_VERTEX_ATTRIB_ARRAY_BARRIER_BIT | GL_BUFFER_UPDATE_BARRIER_BIT);
+    }
+
+private:
+    typedef void (APIENTRYP DispatchComputeProc)(GLuint groupsX, GLuint groupsY, GLuint groupsZ);
+    typedef void (APIENTRYP MemoryBarrierProc)(GLbitfield barriers);
+
+    DispatchComputeProc dispatchCompute = NULL;
+    MemoryBarrierProc memoryBarrier = NULL;
+    GLuint program = 0, pointBuffer = 0, recordBuffer = 0;
+    size_t capacity = 0;
+};
@@ -10,31 +10,98 @@
 #include <fstream>
 #include <sstream>
 #include <algorithm>
+#include <map>
+#include <tuple>
+#include <unordered_map>
+#include <cstring>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+
+#include "bezier_eval.h"
+#include "bezier_simd.h"
+#include "stream_buffer.h"
+#include "overlay_renderer.h"
+#include "tess_patch.h"
+#include "compute_tessellator.h"
 
 using namespace std;
 using namespace glm;
 
+// Everything one CPU rebuild of the single patch reads and writes. The render thread and the
+// tessellation worker each own instances, so a build never touches the live globals.
+struct PatchMesh {
+    vector<vec3> controlPoints;   // snapshot taken when the rebuild was requested
+    int level = 0;
+    bool forwardDifferencing = true, indexed = false;
+    bool adaptive = false;        // screen-space adaptive mesh (T), always indexed
+    mat4 viewProjection = mat4(1.0f);
+    vec2 viewportSize = vec2(0.0f);
+    float pixelsPerSegment = 0.0f;
+    unsigned generation = 0;
+    vector<vec3> vertices;        // position/normal pairs
+    vector<GLuint> indices;       // indexed grid only
+    vector<vec3> grid;            // forward-differencing scratch
+};
+
 // --- Function Prototypes ---
 void framebuffer_size_callback(GLFWwindow* window, int width, int height);
 void key_callback(GLFWwindow* window, int key, int scancode, int action, int mods);
+void mouse_button_callback(GLFWwindow* window, int button, int action, int mods);
+void cursor_position_callback(GLFWwindow* window, double x, double y);
+vec2 cursorToViewport(GLFWwindow* window, double x, double y);
+int pickControlPoint(const vec2& cursor);
+void applyDragEdit();
+void recordDragLatency();
+void reportDragLatency();
 string loadShaderFromFile(const string& filePath);
 GLuint compileShader(GLenum type, const char* src);
 GLuint makeProgram(const string& vertexPath, const string& fragmentPath);
-void updatePatchGeometry();
-vec3 evaluateBezierCurve(const vec3& p0, const vec3& p1, const vec3& p2, const vec3& p3, float t);
-vec3 evaluateBezierPatch(float u, float v);
+GLuint makeTessellationProgram(const string& vertexPath, const string& controlPath, const string& evaluationPath, const string& fragmentPath);
+GLuint makeComputeProgram(const string& computePath);
+void setHardwarePatches();
+void updatePatchGeometry(bool async = false);
+void updateCpuPatchGeometry(bool async);
+void uploadPatchMesh();
+void snapshotPatchInputs(PatchMesh& mesh);
+void requestPatchMesh();
+void applyCompletedPatchMesh();
+void tessellationWorkerLoop();
+void buildPatchMesh(PatchMesh& mesh);
+void buildPatchTrianglesDeCasteljau(PatchMesh& mesh);
+void buildPatchTrianglesForwardDiff(PatchMesh& mesh);
+void buildPatchIndexedGrid(PatchMesh& mesh);
+void buildGpuPatchGrid();
+void buildPatchAdaptive(PatchMesh& mesh);
+bool loadBezierSurface(const string& path);
+void layoutSurfaceVertices();
+void updateSurfaceGeometry();
+void tessellatePatchGridForwardDiff(PatchMesh& mesh);
+void queueControlOverlay();
+bool loadControlPointSequence(const string& path);
+bool readControlPointFrame(istream& in, size_t pointCount, vector<vec3>& frame);
+void readControlPointStream(size_t pointCount);
+bool receiveStreamedFrames();
+void setControlPointAnimation(bool on);
+void animateControlPointsFrame();
+void reportAnimationStats();
 
 // --- Window ---
 int windowWidth = 800, windowHeight = 600;
 
 // --- Shaders ---
-GLuint patchShader, simpleShader;
+GLuint patchShader, simpleShader, gpuPatchShader, tessPatchShader = 0, computePatchShader = 0;
 
 // --- Geometry ---
 vector<vec3> patchVertices;
-GLuint patchVAO = 0, patchVBO = 0;
-GLuint controlPointsVAO = 0, controlPointsVBO = 0;
-GLuint axesVAO = 0, axesVBO = 0;
+vector<GLuint> patchIndices;
+bool patchMeshIndexed = false; // layout of the mesh currently in patchStream, which may lag the N/T flags
+StreamingBuffer patchStream;   // one VAO per ring slot, so edits never re-specify attribute pointers
+GLuint patchVAOs[StreamingBuffer::kSlots] = {}, patchEBO = 0;
+GLuint gpuPatchVAO = 0, gpuPatchVBO = 0, gpuPatchEBO = 0;
+int gpuPatchIndexCount = 0, gpuPatchGridLevel = 0;
+OverlayRenderer overlay; // control points, axes and the control net, one flush per frame
+bool showControlNet = false; // C: control net lines and bounding box
 
 // --- Camera ---
 float camAngle = 45.0f, camPitch = 30.0f, camDist = 8.0f;
@@ -49,8 +116,102 @@ vector<vec3> controlPoints = {
 };
 int tessellationLevel = 10;
 int selectedControlPoint = 0;
+bool useForwardDifferencing = true; // F toggles back to the per-quad de Casteljau path for comparison
+bool useIndexedPatch = false;       // N toggles the shared-vertex grid with analytic normals
+bool useGpuPatch = false;           // G: evaluate the patch in bezier_patch.vert from a static (u,v) grid
+// H: draw every patch as a 16-point GL_PATCHES primitive through bezier_patch.tesc/.tese, with
+// levels from screen-space edge length (adaptivePixelsPerSegment). Off at startup so every
+// other mode behaves as before; available where GL 4.0 tessellation is.
+bool useHardwareTessellation = false;
+TessellatedPatches hardwarePatches;
+
+// --- Background Re-tessellation ---
+// Edits post a snapshot to the worker, which builds into its own back buffer and hands the
+// result over in completedPatchMesh. Requests that arrive while it is busy overwrite each
+// other, so only the newest one is built. The render loop swaps a completed mesh in at the
+// start of a frame; generations let it drop results overtaken by a synchronous rebuild.
+bool useAsyncTessellation = true; // B
+thread tessellationWorker;
+mutex tessellationMutex;
+condition_variable tessellationWake;
+PatchMesh pendingPatchRequest, completedPatchMesh; // guarded by tessellationMutex
+bool patchRequestPending = false, patchMeshCompleted = false, stopTessellationWorker = false;
+unsigned patchGeneration = 0, displayedPatchGeneration = 0;
+PatchMesh syncPatchMesh;
+
+// --- Mouse Dragging ---
+// A click projects every control point with last frame's matrices and grabs the nearest one
+// within dragPickRadius pixels; no readback is involved. While the button is held the point
+// moves in the plane through it parallel to the screen (constant window depth). Cursor events
+// only move the point; the re-tessellation runs once at the start of the next frame.
+// Latency runs from the oldest cursor event not yet on screen to the swap of the first frame
+// whose mesh includes it, and is summarised against dragLatencyBudgetMs when the drag ends.
+const float dragPickRadius = 15.0f;
+const double dragLatencyBudgetMs = 16.0;
+mat4 frameView(1.0f), frameProjection(1.0f);
+int draggedControlPoint = -1;
+float dragDepth = 0.0f;    // window-space depth of the grabbed point
+vec2 dragGrabOffset(0.0f); // grabbed point minus cursor, in pixels
+bool dragEditPending = false;
+int dragEditPoint = -1; // the point the pending edit moved; outlives release and reselection
+double dragEventTime = -1.0;
+unsigned dragTargetGeneration = 0;
+vector<double> dragLatencies; // ms, current drag
+
+// --- Animated Control Points (Throughput Test) ---
+// M moves every control point each frame, replaying the sequence given with --animate
+// <file|-> (3 floats per point, controlPoints.size() points per frame, looped) or else running
+// travelling waves over the starting positions. With -, frames are read on sequenceReader as
+// they arrive and handed over through pendingFrames, so a live pipe never blocks a frame;
+// playback holds the newest frame until the next one comes, and loops once the stream ends. Each frame re-tessellates and uploads
+// synchronously with vsync off, and every animationReportSeconds the sustained frames/s,
+// tessellation and upload ms per frame, and upload MB/s are printed.
+bool animateControlPoints = false; // M
+vector<vec3> animationBase;        // positions when the animation started; restored when it stops
+vector<vector<vec3>> recordedFrames;
+bool streamingSequence = false;
+thread sequenceReader;
+mutex sequenceMutex;
+vector<vector<vec3>> pendingFrames; // guarded by sequenceMutex, as is sequenceStreamEnded
+bool sequenceStreamEnded = false, sequenceEndReported = false;
+size_t animationFrame = 0;
+double animationStartTime = 0.0;
+const double animationReportSeconds = 2.0;
+const float animationAmplitude = 1.0f;
+// Accumulated by every geometry update; reset at each report.
+double statWindowStart = 0.0, statUpdateSeconds = 0.0, statUploadSeconds = 0.0;
+size_t statFrames = 0, statUploadBytes = 0;
+
+// --- Screen-Space Adaptive Tessellation ---
+// The (u,v) domain is split into adaptiveTiles^2 tiles. Each tile edge picks a power-of-two
+// level from its projected length, so both tiles sharing an edge agree on its sampling.
+bool useAdaptiveTessellation = false; // T
+const int adaptiveTiles = 8, adaptiveMaxLevel = 64;
+float adaptivePixelsPerSegment = 8.0f;
+mat4 adaptiveView(1.0f), adaptiveProjection(1.0f);
 
-int main() {
+// --- Multi-Patch Surface (.bpt) ---
+// When a surface is loaded, controlPoints holds the welded control points of every patch
+// and each patch indexes into it, so boundary points are shared between neighbours.
+struct SurfacePatch {
+    int controlIndices[16];
+    int level = 0, firstVertex = 0;   // the patch's (level+1)^2 vertices start at firstVertex
+    bool dirty = true;
+};
+vector<SurfacePatch> surfacePatches;
+vector<vector<int>> patchesUsingPoint;
+GLuint surfaceVAO = 0, surfaceVBO = 0, surfaceEBO = 0;
+int surfaceLevel = 0, surfaceIndexCount = 0;
+vector<float> surfacePatchVertices;
+BezierPatchTessellator surfaceTessellator;
+// E: evaluate the dirty patches with bezier_patch.comp in one dispatch, in place in surfaceVBO,
+// instead of tessellating and uploading them one by one. Off at startup, like H, so the CPU
+// loop stays the default; available where GL 4.3 compute exists. H takes precedence.
+bool useComputeTessellation = false;
+ComputePatchTessellator computeTessellator;
+vector<ComputePatchRecord> computeRecords;
+
+int main(int argc, char** argv) {
     if (!glfwInit()) return -1;
     glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 3);
     glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 0);
@@ -60,40 +221,59 @@ int main() {
     glfwMakeContextCurrent(window);
     glfwSetFramebufferSizeCallback(window, framebuffer_size_callback);
     glfwSetKeyCallback(window, key_callback);
+    glfwSetMouseButtonCallback(window, mouse_button_callback);
+    glfwSetCursorPosCallback(window, cursor_position_callback);
 
     if (!gladLoadGLLoader((GLADloadproc)glfwGetProcAddress)) { cout << "Failed to initialize GLAD" << endl; return -1; }
 
+    string surfacePath, sequencePath;
+    for (int i = 1; i < argc; ++i) {
+        if (string(argv[i]) == "--animate" && i + 1 < argc) sequencePath = argv[++i];
+        else surfacePath = argv[i];
+    }
+    if (!surfacePath.empty() && !loadBezierSurface(surfacePath)) { cerr << "Failed to load Bezier surface: " << surfacePath << endl; return -1; }
+    if (!sequencePath.empty() && !loadControlPointSequence(sequencePath)) { cerr << "Failed to load control point sequence: " << sequencePath << endl; return -1; }
+
     glEnable(GL_DEPTH_TEST);
     glEnable(GL_PROGRAM_POINT_SIZE);
 
     patchShader = makeProgram("shaders/phong.vert", "shaders/phong.frag");
     simpleShader = makeProgram("shaders/simple.vert", "shaders/simple.frag");
+    gpuPatchShader = makeProgram("shaders/bezier_patch.vert", "shaders/phong.frag");
+    if (hardwarePatches.init()) {
+        tessPatchShader = makeTessellationProgram("shaders/bezier_patch_tess.vert", "shaders/bezier_patch.tesc",
+                                                  "shaders/bezier_patch.tese", "shaders/phong.frag");
+        GLint positionLocation = glGetAttribLocation(tessPatchShader, "aPos");
+        if (positionLocation >= 0) {
+            hardwarePatches.setPositionAttribute(positionLocation);
+            setHardwarePatches();
+        } else {
+            tessPatchShader = 0; // failed to link; the error is printed above
+        }
+    }
+    if (computeTessellator.init()) {
+        computePatchShader = makeComputeProgram("shaders/bezier_patch.comp");
+        computeTessellator.setProgram(computePatchShader);
+    }
 
-    glGenVertexArrays(1, &patchVAO);
-    glGenBuffers(1, &patchVBO);
-    glGenVertexArrays(1, &controlPointsVAO);
-    glGenBuffers(1, &controlPointsVBO);
-    glGenVertexArrays(1, &axesVAO);
-    glGenBuffers(1, &axesVBO);
+    patchStream.init();
+    glGenVertexArrays(StreamingBuffer::kSlots, patchVAOs);
+    glGenBuffers(1, &patchEBO);
+    for (GLuint vao : patchVAOs) {
+        glBindVertexArray(vao);
+        glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, patchEBO);
+    }
+    glGenVertexArrays(1, &gpuPatchVAO);
+    glGenBuffers(1, &gpuPatchVBO);
+    glGenBuffers(1, &gpuPatchEBO);
+    glGenVertexArrays(1, &surfaceVAO);
+    glGenBuffers(1, &surfaceVBO);
+    glGenBuffers(1, &surfaceEBO);
+    overlay.init(simpleShader);
 
+    tessellationWorker = thread(tessellationWorkerLoop);
     updatePatchGeometry();
 
-    float axesData[] = {
-        0.0f, 0.0f, 0.0f, 1.0f, 0.0f, 0.0f,
-        1.0f, 0.0f, 0.0f, 1.0f, 0.0f, 0.0f,
-        0.0f, 0.0f, 0.0f, 0.0f, 1.0f, 0.0f,
-        0.0f, 1.0f, 0.0f, 0.0f, 1.0f, 0.0f,
-        0.0f, 0.0f, 0.0f, 0.0f, 0.0f, 1.0f,
-        0.0f, 0.0f, 1.0f, 0.0f, 0.0f, 1.0f,
-    };
-    glBindVertexArray(axesVAO);
-    glBindBuffer(GL_ARRAY_BUFFER, axesVBO);
-    glBufferData(GL_ARRAY_BUFFER, sizeof(axesData), axesData, GL_STATIC_DRAW);
-    glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 6 * sizeof(float), (void*)0);
-    glEnableVertexAttribArray(0);
-    glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, 6 * sizeof(float), (void*)(3 * sizeof(float)));
-    glEnableVertexAttribArray(1);
-
     // --- MODIFIED: Added instructions for number keys ---
     cout << "--- Assignment 4, Part 1: Bezier Patch ---\n"
          << "Controls:\n"
@@ -102,55 +282,89 @@ int main() {
          << "  A/D: Camera Angle\n"
          << "  Z/X: Camera Zoom\n"
          << "  R: Reset View\n"
+         << "  Left Mouse Drag: Pick and Move a Control Point Parallel to the Screen\n"
          << "  0-9: Select Control Points 0-9\n"
          << "  LEFT/RIGHT: Cycle Through Control Points\n"
          << "  U/J (X), I/K (Y), O/L (Z): Move Control Point\n"
-         << "  +/-: Change Tessellation Level\n";
+         << "  +/-: Change Tessellation Level\n"
+         << "  F: Toggle Forward Differencing / de Casteljau Tessellation\n"
+         << "  N: Toggle Indexed Grid with Smooth Normals / Flat Triangles\n"
+         << "  G: Toggle GPU (Vertex Shader) / CPU Patch Evaluation\n"
+         << "  T: Toggle Screen-Space Adaptive Tessellation (+/- then change the pixel tolerance)\n"
+         << "  B: Toggle Background / Synchronous Re-tessellation of Edits\n"
+         << "  C: Toggle Control Net and Bounding Box Overlay\n"
+         << "  M: Toggle Animated Control Points (Throughput Test)\n"
+         << "  H: Toggle Hardware Tessellation Shaders (GL 4.0) / CPU Tessellation\n"
+         << "  E: Toggle Compute-Shader (GL 4.3) / CPU Tessellation of Surface Patches\n"
+         << "Hardware tessellation (H): " << (tessPatchShader ? "available" : "unavailable (no GL 4.0 tessellation support)") << "\n";
+    if (!surfacePatches.empty()) {
+        cout << "Surface patches: CPU tessellation; compute shader (E) " << (computeTessellator.available() ? "available" : "unavailable (no GL 4.3 compute support)") << "\n";
+    }
+    if (!recordedFrames.empty() || streamingSequence) setControlPointAnimation(true);
 
     while (!glfwWindowShouldClose(window)) {
         glClearColor(0.1f, 0.1f, 0.1f, 1.0f);
         glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
 
+        applyDragEdit();
+        animateControlPointsFrame();
+        applyCompletedPatchMesh();
+
         float camX = camDist * cos(radians(camAngle)) * cos(radians(camPitch));
         float camY = camDist * sin(radians(camPitch));
         float camZ = camDist * sin(radians(camAngle)) * cos(radians(camPitch));
         vec3 camPos = vec3(camX, camY, camZ);
         mat4 view = lookAt(camPos, patchCenter, vec3(0.0, 1.0, 0.0));
         mat4 projection = perspective(radians(45.0f), (float)windowWidth / (float)windowHeight, 0.1f, 100.0f);
+        frameView = view;
+        frameProjection = projection;
         
-        glEnable(GL_DEPTH_TEST);
-        glUseProgram(patchShader);
-        glUniformMatrix4fv(glGetUniformLocation(patchShader, "view"), 1, GL_FALSE, value_ptr(view));
-        glUniformMatrix4fv(glGetUniformLocation(patchShader, "projection"), 1, GL_FALSE, value_ptr(projection));
-        glUniform3fv(glGetUniformLocation(patchShader, "lightPos"), 1, value_ptr(camPos));
-        glUniform3f(glGetUniformLocation(patchShader, "lightColor"), 1.0f, 1.0f, 1.0f);
-        glBindVertexArray(patchVAO);
-        glDrawArrays(GL_TRIANGLES, 0, patchVertices.size() / 2);
+        bool drawSurface = !surfacePatches.empty();
+        if (useAdaptiveTessellation && !drawSurface && !useGpuPatch && !useHardwareTessellation &&
+            (view != adaptiveView || projection != adaptiveProjection)) {
+            // Like an edit: with B on, orbiting queues the rebuild and draws the previous mesh.
+            adaptiveView = view;
+            adaptiveProjection = projection;
+            updatePatchGeometry(useAsyncTessellation);
+        }
 
-        glDisable(GL_DEPTH_TEST);
-        glUseProgram(simpleShader);
-        glUniformMatrix4fv(glGetUniformLocation(simpleShader, "view"), 1, GL_FALSE, value_ptr(view));
-        glUniformMatrix4fv(glGetUniformLocation(simpleShader, "projection"), 1, GL_FALSE, value_ptr(projection));
-        
-        glBindVertexArray(controlPointsVAO);
-        for(int i = 0; i < 16; ++i) {
-            if (i == selectedControlPoint) {
-                glPointSize(25.0f);
-                glUniform3f(glGetUniformLocation(simpleShader, "uColor"), 1.0f, 1.0f, 0.0f);
-            } else {
-                glPointSize(15.0f);
-                glUniform3f(glGetUniformLocation(simpleShader, "uColor"), 1.0f, 0.5f, 0.0f);
-            }
-            glDrawArrays(GL_POINTS, i, 1);
+        glEnable(GL_DEPTH_TEST);
+        GLuint shader = useHardwareTessellation ? tessPatchShader : (useGpuPatch && !drawSurface) ? gpuPatchShader : patchShader;
+        glUseProgram(shader);
+        glUniformMatrix4fv(glGetUniformLocation(shader, "view"), 1, GL_FALSE, value_ptr(view));
+        glUniformMatrix4fv(glGetUniformLocation(shader, "projection"), 1, GL_FALSE, value_ptr(projection));
+        glUniform3fv(glGetUniformLocation(shader, "lightPos"), 1, value_ptr(camPos));
+        glUniform3f(glGetUniformLocation(shader, "lightColor"), 1.0f, 1.0f, 1.0f);
+        if (useHardwareTessellation) {
+            hardwarePatches.draw(shader, vec2(windowWidth, windowHeight), adaptivePixelsPerSegment);
+        } else if (drawSurface) {
+            glBindVertexArray(surfaceVAO);
+            glDrawElements(GL_TRIANGLES, surfaceIndexCount, GL_UNSIGNED_INT, 0);
+        } else if (useGpuPatch) {
+            glBindVertexArray(gpuPatchVAO);
+            glDrawElements(GL_TRIANGLES, gpuPatchIndexCount, GL_UNSIGNED_INT, 0);
+        } else {
+            glBindVertexArray(patchVAOs[patchStream.slot()]);
+            if (patchMeshIndexed) glDrawElements(GL_TRIANGLES, patchIndices.size(), GL_UNSIGNED_INT, 0);
+            else glDrawArrays(GL_TRIANGLES, 0, patchVertices.size() / 2);
+            patchStream.fence();
         }
 
-        glLineWidth(3.0f);
-        glBindVertexArray(axesVAO);
-        glDrawArrays(GL_LINES, 0, 6);
+        glDisable(GL_DEPTH_TEST);
+        queueControlOverlay();
+        overlay.flush(view, projection, 3.0f);
 
         glfwSwapBuffers(window);
+        recordDragLatency();
         glfwPollEvents();
     }
+
+    {
+        lock_guard<mutex> lock(tessellationMutex);
+        stopTessellationWorker = true;
+    }
+    tessellationWake.notify_one();
+    tessellationWorker.join();
     glfwTerminate();
     return 0;
 }
@@ -174,8 +388,9 @@ void key_callback(GLFWwindow* window, int key, int, int action, int) {
     if (key == GLFW_KEY_X) camDist += 0.2f;
     if (key == GLFW_KEY_R) { camAngle = 45.0f; camPitch = 30.0f; camDist = 8.0f; }
 
-    if (key == GLFW_KEY_LEFT) selectedControlPoint = (selectedControlPoint - 1 + 16) % 16;
-    if (key == GLFW_KEY_RIGHT) selectedControlPoint = (selectedControlPoint + 1) % 16;
+    int pointCount = controlPoints.size();
+    if (key == GLFW_KEY_LEFT) selectedControlPoint = (selectedControlPoint - 1 + pointCount) % pointCount;
+    if (key == GLFW_KEY_RIGHT) selectedControlPoint = (selectedControlPoint + 1) % pointCount;
 
     // --- NEW: Handle number keys to select a control point directly ---
     if (key >= GLFW_KEY_0 && key <= GLFW_KEY_9) {
@@ -190,71 +405,810 @@ void key_callback(GLFWwindow* window, int key, int, int action, int) {
     if (key == GLFW_KEY_O) { controlPoints[selectedControlPoint].z += step; needsUpdate = true; }
     if (key == GLFW_KEY_L) { controlPoints[selectedControlPoint].z -= step; needsUpdate = true; }
 
+    bool screenSpaceLevels = useAdaptiveTessellation || useHardwareTessellation;
+    if (screenSpaceLevels && (key == GLFW_KEY_EQUAL || key == GLFW_KEY_KP_ADD || key == GLFW_KEY_MINUS || key == GLFW_KEY_KP_SUBTRACT)) {
+        bool finer = key == GLFW_KEY_EQUAL || key == GLFW_KEY_KP_ADD;
+        adaptivePixelsPerSegment = glm::clamp(adaptivePixelsPerSegment * (finer ? 0.5f : 2.0f), 1.0f, 256.0f);
+        if (useHardwareTessellation) {
+            cout << "Hardware tessellation tolerance: " << adaptivePixelsPerSegment << " px/segment" << endl;
+            return;
+        }
+        updatePatchGeometry();
+        cout << "Adaptive tolerance: " << adaptivePixelsPerSegment << " px/segment, " << patchIndices.size() / 3 << " triangles" << endl;
+        return;
+    }
     if (key == GLFW_KEY_EQUAL || key == GLFW_KEY_KP_ADD) { tessellationLevel = glm::min(100, tessellationLevel + 1); needsUpdate = true; }
     if (key == GLFW_KEY_MINUS || key == GLFW_KEY_KP_SUBTRACT) { if (tessellationLevel > 1) { tessellationLevel--; needsUpdate = true; } }
 
-    if(needsUpdate) updatePatchGeometry();
+    if (key == GLFW_KEY_F && action == GLFW_PRESS) {
+        useForwardDifferencing = !useForwardDifferencing;
+        double start = glfwGetTime();
+        updatePatchGeometry();
+        cout << "Tessellation: " << (useForwardDifferencing ? "Forward Differencing" : "de Casteljau")
+             << " (" << (glfwGetTime() - start) * 1000.0 << " ms at level " << tessellationLevel << ")" << endl;
+        return;
+    }
+    if (key == GLFW_KEY_N && action == GLFW_PRESS) {
+        useIndexedPatch = !useIndexedPatch;
+        updatePatchGeometry();
+        // patchVertices only describes what is drawn on the single-patch CPU path.
+        bool cpuPatch = surfacePatches.empty() && !useGpuPatch && !useHardwareTessellation && !useAdaptiveTessellation;
+        cout << "Patch mesh: " << (useIndexedPatch ? "Indexed grid" : "Triangle list");
+        if (cpuPatch) cout << ", " << patchVertices.size() / 2 << " vertices, " << patchVertices.size() * sizeof(vec3) / 1024 << " KB";
+        else cout << " (applies to the CPU patch; the current path doesn't use it)";
+        cout << endl;
+        return;
+    }
+    if (key == GLFW_KEY_T && action == GLFW_PRESS) {
+        useAdaptiveTessellation = !useAdaptiveTessellation;
+        updatePatchGeometry();
+        if (useAdaptiveTessellation) cout << "Adaptive tessellation: ON, " << patchIndices.size() / 3 << " triangles" << endl;
+        else cout << "Adaptive tessellation: OFF" << endl;
+        return;
+    }
+    if (key == GLFW_KEY_B && action == GLFW_PRESS) {
+        useAsyncTessellation = !useAsyncTessellation;
+        cout << "Re-tessellation of edits: " << (useAsyncTessellation ? "Background thread" : "Synchronous") << endl;
+        return;
+    }
+    if (key == GLFW_KEY_H && action == GLFW_PRESS) {
+        if (!tessPatchShader) {
+            cout << "Hardware tessellation needs GL 4.0 or ARB_tessellation_shader" << endl;
+            return;
+        }
+        useHardwareTessellation = !useHardwareTessellation;
+        updatePatchGeometry();
+        cout << "Patch path: " << (useHardwareTessellation ? "hardware tessellation shaders" : "CPU / vertex shader") << endl;
+        return;
+    }
+    if (key == GLFW_KEY_E && action == GLFW_PRESS) {
+        if (!computeTessellator.available()) {
+            cout << "Compute tessellation needs GL 4.3 or ARB_compute_shader and ARB_shader_storage_buffer_object" << endl;
+            return;
+        }
+        useComputeTessellation = !useComputeTessellation;
+        for (SurfacePatch& patch : surfacePatches) patch.dirty = true;
+        double start = glfwGetTime();
+        updatePatchGeometry();
+        cout << "Surface tessellation: " << (useComputeTessellation ? "compute shader" : "CPU")
+             << " (" << (glfwGetTime() - start) * 1000.0 << " ms for " << surfacePatches.size() << " patches at level " << tessellationLevel << ")" << endl;
+        return;
+    }
+    if (key == GLFW_KEY_M && action == GLFW_PRESS) {
+        setControlPointAnimation(!animateControlPoints);
+        return;
+    }
+    if (key == GLFW_KEY_C && action == GLFW_PRESS) {
+        showControlNet = !showControlNet;
+        cout << "Control net overlay: " << (showControlNet ? "ON" : "OFF") << endl;
+        return;
+    }
+    if (key == GLFW_KEY_G && action == GLFW_PRESS) {
+        useGpuPatch = !useGpuPatch;
+        updatePatchGeometry();
+        cout << "Patch evaluation: " << (useGpuPatch ? "GPU (vertex shader)" : "CPU") << endl;
+        return;
+    }
+
+    if (needsUpdate && !surfacePatches.empty()) {
+        for (int p : patchesUsingPoint[selectedControlPoint]) surfacePatches[p].dirty = true;
+    }
+
+    if(needsUpdate) updatePatchGeometry(useAsyncTessellation);
+}
+
+void mouse_button_callback(GLFWwindow* window, int button, int action, int) {
+    if (button != GLFW_MOUSE_BUTTON_LEFT) return;
+    if (action == GLFW_RELEASE) { draggedControlPoint = -1; return; }
+    if (action != GLFW_PRESS) return;
+
+    double x, y;
+    glfwGetCursorPos(window, &x, &y);
+    vec2 cursor = cursorToViewport(window, x, y);
+    int hit = pickControlPoint(cursor);
+    if (hit < 0) return;
+    vec3 screen = project(controlPoints[hit], frameView, frameProjection, vec4(0, 0, windowWidth, windowHeight));
+    selectedControlPoint = draggedControlPoint = hit;
+    dragDepth = screen.z;
+    dragGrabOffset = vec2(screen) - cursor;
+    dragLatencies.clear();
+}
+
+void cursor_position_callback(GLFWwindow* window, double x, double y) {
+    if (draggedControlPoint < 0) return;
+    vec3 target(cursorToViewport(window, x, y) + dragGrabOffset, dragDepth);
+    controlPoints[draggedControlPoint] = unProject(target, frameView, frameProjection, vec4(0, 0, windowWidth, windowHeight));
+    // A second drag starting before the next frame would overwrite dragEditPoint; mark the
+    // first point's patches now so its move isn't lost.
+    if (dragEditPending && dragEditPoint != draggedControlPoint && !surfacePatches.empty()) {
+        for (int p : patchesUsingPoint[dragEditPoint]) surfacePatches[p].dirty = true;
+    }
+    dragEditPending = true;
+    dragEditPoint = draggedControlPoint;
+    if (dragEventTime < 0.0) dragEventTime = glfwGetTime();
+}
+
+// Cursor position in framebuffer pixels, origin bottom-left like the viewport.
+vec2 cursorToViewport(GLFWwindow* window, double x, double y) {
+    int width, height;
+    glfwGetWindowSize(window, &width, &height);
+    float sx = width ? (float)windowWidth / width : 1.0f, sy = height ? (float)windowHeight / height : 1.0f;
+    return vec2(x * sx, windowHeight - y * sy);
+}
+
+// Index of the control point projecting closest to the cursor within dragPickRadius, or -1.
+int pickControlPoint(const vec2& cursor) {
+    vec4 viewport(0, 0, windowWidth, windowHeight);
+    int best = -1;
+    float bestDistance = dragPickRadius;
+    for (int i = 0; i < (int)controlPoints.size(); ++i) {
+        vec3 screen = project(controlPoints[i], frameView, frameProjection, viewport);
+        if (screen.z < 0.0f || screen.z > 1.0f) continue; // behind the camera or clipped
+        float distance = length(vec2(screen) - cursor);
+        if (distance <= bestDistance) { best = i; bestDistance = distance; }
+    }
+    return best;
+}
+
+// Start of frame: one re-tessellation for all cursor events since the last frame.
+void applyDragEdit() {
+    if (!dragEditPending) return;
+    dragEditPending = false;
+    if (!surfacePatches.empty()) {
+        for (int p : patchesUsingPoint[dragEditPoint]) surfacePatches[p].dirty = true;
+    }
+    updatePatchGeometry(useAsyncTessellation);
+    dragTargetGeneration = patchGeneration;
+}
+
+// After the swap. The surface and GPU paths apply an edit within the frame; the CPU patch
+// shows it once the displayed mesh is at least as new as the edit's request.
+void recordDragLatency() {
+    if (dragEventTime >= 0.0) {
+        bool cpuPatch = surfacePatches.empty() && !useGpuPatch && !useHardwareTessellation;
+        if (dragEditPending || (cpuPatch && displayedPatchGeneration < dragTargetGeneration)) return;
+        dragLatencies.push_back((glfwGetTime() - dragEventTime) * 1000.0);
+        dragEventTime = -1.0;
+    }
+    if (draggedControlPoint < 0 && !dragLatencies.empty()) {
+        reportDragLatency();
+        dragLatencies.clear();
+    }
+}
+
+void reportDragLatency() {
+    vector<double> sorted = dragLatencies;
+    sort(sorted.begin(), sorted.end());
+    double sum = 0.0;
+    for (double ms : sorted) sum += ms;
+    size_t overBudget = sorted.end() - upper_bound(sorted.begin(), sorted.end(), dragLatencyBudgetMs);
+    size_t p95Rank = (sorted.size() * 95 + 99) / 100; // nearest rank, ceil(0.95 n)
+    const char* path = useHardwareTessellation ? "hardware tessellation" : !surfacePatches.empty() ? (useComputeTessellation ? "compute surface" : "surface") : useGpuPatch ? "GPU"
+                     : useAsyncTessellation ? "background CPU" : "synchronous CPU";
+    cout << "Drag of point " << selectedControlPoint << ": " << sorted.size() << " updates at level " << tessellationLevel
+         << " (" << path << "), latency mean " << sum / sorted.size() << " ms, p95 " << sorted[p95Rank - 1] << " ms (of " << sorted.size()
+         << " samples), max " << sorted.back() << " ms, " << overBudget << " over the " << dragLatencyBudgetMs << " ms budget" << endl;
+}
+
+// async only affects the single CPU patch; the surface and GPU paths are cheap enough to stay inline.
+void updatePatchGeometry(bool async) {
+    if (useHardwareTessellation) {
+        // Surface patches stay marked dirty, so the CPU path catches up if H switches back.
+        hardwarePatches.setControlPoints(controlPoints.data(), controlPoints.size());
+        statUploadBytes += controlPoints.size() * sizeof(vec3);
+    } else if (!surfacePatches.empty()) {
+        updateSurfaceGeometry();
+    } else if (useGpuPatch) {
+        // The (u,v) grid only changes with the tessellation level; an edit is one uniform upload.
+        if (gpuPatchGridLevel != tessellationLevel) buildGpuPatchGrid();
+        glUseProgram(gpuPatchShader);
+        glUniform3fv(glGetUniformLocation(gpuPatchShader, "controlPoints"), 16, value_ptr(controlPoints[0]));
+        statUploadBytes += 16 * sizeof(vec3);
+    } else {
+        updateCpuPatchGeometry(async);
+    }
+}
+
+// One GL_PATCHES primitive per patch: the single patch is points 0..15, a surface uses the
+// welded indices of each patch.
+void setHardwarePatches() {
+    vector<int> indices;
+    if (surfacePatches.empty()) {
+        for (int k = 0; k < 16; ++k) indices.push_back(k);
+    }
+    for (const SurfacePatch& patch : surfacePatches) indices.insert(indices.end(), patch.controlIndices, patch.controlIndices + 16);
+    hardwarePatches.setPatches(indices.data(), indices.size() / 16);
+}
+
+// Control points (the selected one larger and yellow), the world axes and, with C, the control
+// net of every patch and the control points' bounding box.
+void queueControlOverlay() {
+    if (showControlNet) {
+        vec3 netColor(0.5f, 0.5f, 0.6f);
+        vec3 lo = controlPoints[0], hi = controlPoints[0];
+        for (const vec3& p : controlPoints) { lo = glm::min(lo, p); hi = glm::max(hi, p); }
+        overlay.box(lo, hi, vec3(0.3f, 0.6f, 0.3f));
+        if (surfacePatches.empty()) {
+            for (int k = 0; k < 4; ++k) {
+                overlay.polyline(&controlPoints[k * 4], 4, netColor);
+                overlay.polyline(&controlPoints[k], 4, netColor, 4);
+            }
+        }
+        for (const SurfacePatch& patch : surfacePatches) {
+            for (int k = 0; k < 4; ++k) {
+                for (int m = 0; m < 3; ++m) {
+                    const int* cp = patch.controlIndices;
+                    overlay.line(controlPoints[cp[k * 4 + m]], controlPoints[cp[k * 4 + m + 1]], netColor);
+                    overlay.line(controlPoints[cp[m * 4 + k]], controlPoints[cp[(m + 1) * 4 + k]], netColor);
+                }
+            }
+        }
+    }
+    for (int i = 0; i < (int)controlPoints.size(); ++i) {
+        if (i == selectedControlPoint) overlay.point(controlPoints[i], vec3(1.0f, 1.0f, 0.0f), 25.0f);
+        else overlay.point(controlPoints[i], vec3(1.0f, 0.5f, 0.0f), 15.0f);
+    }
+    overlay.axes(vec3(0.0f), 1.0f);
+}
+
+void updateCpuPatchGeometry(bool async) {
+    if (async) {
+        requestPatchMesh();
+        return;
+    }
+
+    // Anything still in flight on the worker is older than this mesh.
+    displayedPatchGeneration = ++patchGeneration;
+    snapshotPatchInputs(syncPatchMesh);
+    buildPatchMesh(syncPatchMesh);
+    patchVertices.swap(syncPatchMesh.vertices);
+    patchIndices.swap(syncPatchMesh.indices);
+    patchMeshIndexed = syncPatchMesh.indexed || syncPatchMesh.adaptive;
+    uploadPatchMesh();
+}
+
+// The mesh is built off the GL thread (or by the adaptive pass), so it is copied into the
+// next slot of the streaming ring rather than tessellated into the mapping directly.
+void uploadPatchMesh() {
+    double start = glfwGetTime();
+    size_t bytes = patchVertices.size() * sizeof(vec3);
+    do {
+        void* dst = patchStream.beginWrite(bytes);
+        if (!dst) { cerr << "Failed to map the patch vertex buffer" << endl; return; }
+        memcpy(dst, patchVertices.data(), bytes);
+    } while (!patchStream.endWrite());
+
+    glBindVertexArray(patchVAOs[patchStream.slot()]);
+    if (patchStream.slotResized()) {
+        glBindBuffer(GL_ARRAY_BUFFER, patchStream.buffer());
+        glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 6 * sizeof(float), (void*)0);
+        glEnableVertexAttribArray(0);
+        glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, 6 * sizeof(float), (void*)(3 * sizeof(float)));
+        glEnableVertexAttribArray(1);
+    }
+    if (patchMeshIndexed) {
+        glBufferData(GL_ELEMENT_ARRAY_BUFFER, patchIndices.size() * sizeof(GLuint), patchIndices.data(), GL_DYNAMIC_DRAW);
+        bytes += patchIndices.size() * sizeof(GLuint);
+    }
+    statUploadBytes += bytes;
+    statUploadSeconds += glfwGetTime() - start;
+}
+
+void snapshotPatchInputs(PatchMesh& mesh) {
+    mesh.controlPoints = controlPoints;
+    mesh.level = tessellationLevel;
+    mesh.forwardDifferencing = useForwardDifferencing;
+    mesh.indexed = useIndexedPatch;
+    mesh.adaptive = useAdaptiveTessellation;
+    mesh.viewProjection = adaptiveProjection * adaptiveView;
+    mesh.viewportSize = vec2(windowWidth, windowHeight);
+    mesh.pixelsPerSegment = adaptivePixelsPerSegment;
+}
+
+void requestPatchMesh() {
+    {
+        lock_guard<mutex> lock(tessellationMutex);
+        snapshotPatchInputs(pendingPatchRequest);
+        pendingPatchRequest.generation = ++patchGeneration;
+        patchRequestPending = true;
+    }
+    tessellationWake.notify_one();
+}
+
+// Called once per frame. The swap only exchanges vector storage, so the lock is held briefly
+// and the previous front buffers go back to the worker for reuse.
+void applyCompletedPatchMesh() {
+    {
+        lock_guard<mutex> lock(tessellationMutex);
+        if (!patchMeshCompleted) return;
+        patchMeshCompleted = false;
+        if (completedPatchMesh.generation <= displayedPatchGeneration) return;
+        patchVertices.swap(completedPatchMesh.vertices);
+        patchIndices.swap(completedPatchMesh.indices);
+        patchMeshIndexed = completedPatchMesh.indexed || completedPatchMesh.adaptive;
+        displayedPatchGeneration = completedPatchMesh.generation;
+    }
+    uploadPatchMesh();
+}
+
+void tessellationWorkerLoop() {
+    PatchMesh back;
+    for (;;) {
+        {
+            unique_lock<mutex> lock(tessellationMutex);
+            tessellationWake.wait(lock, [] { return patchRequestPending || stopTessellationWorker; });
+            if (stopTessellationWorker) return;
+            back.controlPoints = pendingPatchRequest.controlPoints;
+            back.level = pendingPatchRequest.level;
+            back.forwardDifferencing = pendingPatchRequest.forwardDifferencing;
+            back.indexed = pendingPatchRequest.indexed;
+            back.adaptive = pendingPatchRequest.adaptive;
+            back.viewProjection = pendingPatchRequest.viewProjection;
+            back.viewportSize = pendingPatchRequest.viewportSize;
+            back.pixelsPerSegment = pendingPatchRequest.pixelsPerSegment;
+            back.generation = pendingPatchRequest.generation;
+            patchRequestPending = false;
+        }
+        buildPatchMesh(back);
+        {
+            // An unconsumed older result is simply replaced; its buffers become the next back buffer.
+            lock_guard<mutex> lock(tessellationMutex);
+            swap(back, completedPatchMesh);
+            patchMeshCompleted = true;
+        }
+    }
+}
+
+// Whitespace-separated floats, 3 per control point; a trailing partial frame is dropped.
+// A file is read whole; standard input is left to readControlPointStream.
+bool loadControlPointSequence(const string& path) {
+    recordedFrames.clear();
+    if (path == "-") {
+        // Blocked in cin until the pipe closes, so it is detached rather than joined at exit.
+        streamingSequence = true;
+        sequenceReader = thread(readControlPointStream, controlPoints.size());
+        sequenceReader.detach();
+        cout << "Streaming frames of " << controlPoints.size() << " control points from standard input" << endl;
+        return true;
+    }
+    ifstream file(path);
+    if (!file.is_open()) return false;
+    vector<vec3> frame;
+    while (readControlPointFrame(file, controlPoints.size(), frame)) recordedFrames.push_back(frame);
+    if (recordedFrames.empty()) return false;
+    cout << "Loaded " << recordedFrames.size() << " frames of " << controlPoints.size() << " control points from " << path << endl;
+    return true;
+}
+
+bool readControlPointFrame(istream& in, size_t pointCount, vector<vec3>& frame) {
+    frame.resize(pointCount);
+    for (vec3& p : frame) {
+        if (!(in >> p.x >> p.y >> p.z)) return false;
+    }
+    return true;
+}
+
+// sequenceReader: queues each complete frame as soon as its last float has been read.
+void readControlPointStream(size_t pointCount) {
+    vector<vec3> frame;
+    while (readControlPointFrame(cin, pointCount, frame)) {
+        lock_guard<mutex> lock(sequenceMutex);
+        pendingFrames.push_back(frame);
+    }
+    lock_guard<mutex> lock(sequenceMutex);
+    sequenceStreamEnded = true;
+}
+
+// Moves the frames that arrived since the last call onto recordedFrames. Returns whether the
+// stream has ended, i.e. recordedFrames is complete and playback may loop.
+bool receiveStreamedFrames() {
+    lock_guard<mutex> lock(sequenceMutex);
+    for (vector<vec3>& frame : pendingFrames) recordedFrames.push_back(move(frame));
+    pendingFrames.clear();
+    if (sequenceStreamEnded && !sequenceEndReported) {
+        sequenceEndReported = true;
+        cout << "Control point stream ended after " << recordedFrames.size() << " frames" << (recordedFrames.empty() ? "" : "; looping") << endl;
+    }
+    return sequenceStreamEnded;
+}
+
+void setControlPointAnimation(bool on) {
+    animateControlPoints = on;
+    if (on) {
+        animationBase = controlPoints;
+        animationFrame = 0;
+        animationStartTime = statWindowStart = glfwGetTime();
+        statUpdateSeconds = statUploadSeconds = 0.0;
+        statFrames = statUploadBytes = 0;
+    } else {
+        controlPoints = animationBase;
+        for (SurfacePatch& patch : surfacePatches) patch.dirty = true;
+        updatePatchGeometry();
+    }
+    glfwSwapInterval(on ? 0 : 1);
+    cout << "Animated control points: " << (on ? (recordedFrames.empty() && !streamingSequence ? "ON (waves)" : "ON (recorded sequence)") : "OFF") << endl;
+}
+
+// Start of frame: move the points, then one synchronous re-tessellation and upload.
+void animateControlPointsFrame() {
+    if (!animateControlPoints) return;
+    bool sequenceComplete = !streamingSequence || receiveStreamedFrames();
+    if (streamingSequence || !recordedFrames.empty()) {
+        if (animationFrame >= recordedFrames.size()) {
+            if (!sequenceComplete || recordedFrames.empty()) return; // nothing new to show yet
+            animationFrame = 0;
+        }
+        controlPoints = recordedFrames[animationFrame++];
+    } else {
+        float t = glfwGetTime() - animationStartTime;
+        for (size_t i = 0; i < controlPoints.size(); ++i) {
+            const vec3& base = animationBase[i];
+            controlPoints[i] = base + vec3(0.0f, 0.0f, animationAmplitude * sin(3.0f * t + 1.5f * base.x + base.y));
+        }
+    }
+    for (SurfacePatch& patch : surfacePatches) patch.dirty = true;
+
+    double start = glfwGetTime();
+    updatePatchGeometry();
+    statUpdateSeconds += glfwGetTime() - start;
+    ++statFrames;
+    if (glfwGetTime() - statWindowStart >= animationReportSeconds) reportAnimationStats();
+}
+
+void reportAnimationStats() {
+    double now = glfwGetTime(), elapsed = now - statWindowStart;
+    const char* path = useHardwareTessellation ? "hardware tessellation" : !surfacePatches.empty() ? (useComputeTessellation ? "compute surface" : "surface") : useGpuPatch ? "GPU"
+                     : useAdaptiveTessellation ? "adaptive CPU" : "CPU";
+    cout << "Animation (" << path << ", level " << tessellationLevel << "): " << statFrames / elapsed << " frames/s, tessellation "
+         << (statUpdateSeconds - statUploadSeconds) * 1000.0 / statFrames << " ms, upload " << statUploadSeconds * 1000.0 / statFrames
+         << " ms per frame, " << statUploadBytes / elapsed / 1e6 << " MB/s" << endl;
+    statWindowStart = now;
+    statUpdateSeconds = statUploadSeconds = 0.0;
+    statFrames = statUploadBytes = 0;
+}
+
+// Reads a teapot-style .bpt file: a patch count, then per patch a "3 3" degree line and
+// 16 control points. Identical points are welded so patches share their boundaries.
+bool loadBezierSurface(const string& path) {
+    ifstream file(path);
+    if (!file.is_open()) return false;
+
+    int patchCount = 0;
+    if (!(file >> patchCount) || patchCount <= 0) return false;
+
+    map<tuple<float, float, float>, int> pointIndex;
+    vector<vec3> points;
+    vector<SurfacePatch> patches(patchCount);
+    for (int p = 0; p < patchCount; ++p) {
+        int degreeU, degreeV;
+        if (!(file >> degreeU >> degreeV)) return false;
+        if (degreeU != 3 || degreeV != 3) { cerr << "Only bicubic patches are supported (patch " << p << ")" << endl; return false; }
+        for (int k = 0; k < 16; ++k) {
+            vec3 cp;
+            if (!(file >> cp.x >> cp.y >> cp.z)) return false;
+            auto key = make_tuple(cp.x, cp.y, cp.z);
+            auto it = pointIndex.find(key);
+            if (it == pointIndex.end()) {
+                it = pointIndex.emplace(key, (int)points.size()).first;
+                points.push_back(cp);
+            }
+            patches[p].controlIndices[k] = it->second;
+        }
+    }
+
+    controlPoints = points;
+    surfacePatches = patches;
+    patchesUsingPoint.assign(points.size(), vector<int>());
+    for (int p = 0; p < patchCount; ++p) {
+        for (int k = 0; k < 16; ++k) {
+            vector<int>& users = patchesUsingPoint[surfacePatches[p].controlIndices[k]];
+            if (find(users.begin(), users.end(), p) == users.end()) users.push_back(p);
+        }
+    }
+
+    vec3 lo = points[0], hi = points[0];
+    for (const vec3& cp : points) { lo = glm::min(lo, cp); hi = glm::max(hi, cp); }
+    patchCenter = (lo + hi) * 0.5f;
+    camDist = glm::max(8.0f, length(hi - lo) * 1.5f);
+    selectedControlPoint = 0;
+    cout << "Loaded " << patchCount << " patches with " << points.size() << " shared control points from " << path << endl;
+    return true;
+}
+
+// Gives every patch its level and vertex range in one VBO of position/normal/(u,v) vertices,
+// reallocates it and rebuilds the index list. All patches use tessellationLevel for now; the
+// ranges and the compute records carry a level per patch.
+void layoutSurfaceVertices() {
+    const GLsizei stride = ComputePatchTessellator::kFloatsPerVertex * sizeof(float);
+    vector<GLuint> indices;
+    int vertexCount = 0;
+    for (SurfacePatch& patch : surfacePatches) {
+        patch.level = tessellationLevel;
+        patch.firstVertex = vertexCount;
+        patch.dirty = true;
+        int n = patch.level;
+        for (int i = 0; i < n; ++i) {
+            for (int j = 0; j < n; ++j) {
+                GLuint i00 = patch.firstVertex + i * (n + 1) + j, i01 = i00 + 1;
+                GLuint i10 = i00 + (n + 1), i11 = i10 + 1;
+                indices.insert(indices.end(), {i00, i10, i01, i10, i11, i01});
+            }
+        }
+        vertexCount += (n + 1) * (n + 1);
+    }
+
+    glBindVertexArray(surfaceVAO);
+    glBindBuffer(GL_ARRAY_BUFFER, surfaceVBO);
+    glBufferData(GL_ARRAY_BUFFER, (GLsizeiptr)vertexCount * stride, NULL, GL_DYNAMIC_DRAW);
+    glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, stride, (void*)0);
+    glEnableVertexAttribArray(0);
+    glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, stride, (void*)(3 * sizeof(float)));
+    glEnableVertexAttribArray(1);
+    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, surfaceEBO);
+    glBufferData(GL_ELEMENT_ARRAY_BUFFER, indices.size() * sizeof(GLuint), indices.data(), GL_STATIC_DRAW);
+    surfaceIndexCount = indices.size();
+    surfaceLevel = tessellationLevel;
 }
 
-// ... (The rest of the file is unchanged) ...
-void updatePatchGeometry() {
-    patchVertices.clear();
-    float step = 1.0f / tessellationLevel;
+// Only patches marked dirty by an edit are re-evaluated. With E, one compute dispatch writes
+// all of them in place and only the control points and patch records are uploaded; otherwise
+// each is tessellated on the CPU and its range re-sent with glBufferSubData.
+void updateSurfaceGeometry() {
+    if (surfaceLevel != tessellationLevel) layoutSurfaceVertices();
+
+    if (useComputeTessellation) {
+        computeRecords.clear();
+        for (SurfacePatch& patch : surfacePatches) {
+            if (!patch.dirty) continue;
+            ComputePatchRecord record;
+            memcpy(record.controlIndices, patch.controlIndices, sizeof(record.controlIndices));
+            record.level = patch.level;
+            record.firstVertex = patch.firstVertex;
+            computeRecords.push_back(record);
+            patch.dirty = false;
+        }
+        if (computeRecords.empty()) return;
+        double start = glfwGetTime();
+        computeTessellator.setControlPoints(controlPoints.data(), controlPoints.size());
+        statUploadSeconds += glfwGetTime() - start;
+        statUploadBytes += controlPoints.size() * sizeof(vec3) + computeRecords.size() * sizeof(ComputePatchRecord);
+        computeTessellator.tessellate(computeRecords.data(), computeRecords.size(), surfaceVBO);
+        return;
+    }
 
-    for (int i = 0; i < tessellationLevel; ++i) {
-        for (int j = 0; j < tessellationLevel; ++j) {
+    const int floatsPerVertex = ComputePatchTessellator::kFloatsPerVertex;
+    glBindBuffer(GL_ARRAY_BUFFER, surfaceVBO);
+    for (SurfacePatch& patch : surfacePatches) {
+        if (!patch.dirty) continue;
+        int n = patch.level;
+        GLsizeiptr bytes = (GLsizeiptr)(n + 1) * (n + 1) * floatsPerVertex * sizeof(float);
+        surfacePatchVertices.resize((n + 1) * (n + 1) * floatsPerVertex);
+        vec3 cps[16];
+        for (int k = 0; k < 16; ++k) cps[k] = controlPoints[patch.controlIndices[k]];
+        surfaceTessellator.setLevel(n);
+        surfaceTessellator.setControlPoints(cps);
+        surfaceTessellator.tessellate(surfacePatchVertices.data(), floatsPerVertex);
+        double start = glfwGetTime();
+        glBufferSubData(GL_ARRAY_BUFFER, (GLintptr)patch.firstVertex * floatsPerVertex * sizeof(float), bytes, surfacePatchVertices.data());
+        statUploadSeconds += glfwGetTime() - start;
+        statUploadBytes += bytes;
+        patch.dirty = false;
+    }
+}
+
+// Static (u,v) grid for bezier_patch.vert, which evaluates position and normal per vertex.
+void buildGpuPatchGrid() {
+    int n = tessellationLevel;
+    vector<vec2> uvs;
+    vector<GLuint> indices;
+    uvs.reserve((n + 1) * (n + 1));
+    for (int i = 0; i <= n; ++i)
+        for (int j = 0; j <= n; ++j)
+            uvs.push_back(vec2((float)i / n, (float)j / n));
+    indices.reserve(n * n * 6);
+    for (int i = 0; i < n; ++i) {
+        for (int j = 0; j < n; ++j) {
+            GLuint i00 = i * (n + 1) + j, i01 = i00 + 1;
+            GLuint i10 = i00 + (n + 1), i11 = i10 + 1;
+            indices.insert(indices.end(), {i00, i10, i01, i10, i11, i01});
+        }
+    }
+
+    GLint uvLocation = glGetAttribLocation(gpuPatchShader, "aUV");
+    glBindVertexArray(gpuPatchVAO);
+    glBindBuffer(GL_ARRAY_BUFFER, gpuPatchVBO);
+    glBufferData(GL_ARRAY_BUFFER, uvs.size() * sizeof(vec2), uvs.data(), GL_STATIC_DRAW);
+    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, gpuPatchEBO);
+    glBufferData(GL_ELEMENT_ARRAY_BUFFER, indices.size() * sizeof(GLuint), indices.data(), GL_STATIC_DRAW);
+    glVertexAttribPointer(uvLocation, 2, GL_FLOAT, GL_FALSE, 2 * sizeof(float), (void*)0);
+    glEnableVertexAttribArray(uvLocation);
+    gpuPatchIndexCount = indices.size();
+    gpuPatchGridLevel = n;
+}
+
+void buildPatchMesh(PatchMesh& mesh) {
+    mesh.vertices.clear();
+    if (mesh.adaptive) buildPatchAdaptive(mesh);
+    else if (mesh.indexed) buildPatchIndexedGrid(mesh);
+    else {
+        mesh.vertices.reserve(mesh.level * mesh.level * 12);
+        if (mesh.forwardDifferencing) buildPatchTrianglesForwardDiff(mesh);
+        else buildPatchTrianglesDeCasteljau(mesh);
+    }
+}
+
+// Reference path: evaluates every quad corner independently, so interior points are computed four times.
+void buildPatchTrianglesDeCasteljau(PatchMesh& mesh) {
+    const vec3* cp = mesh.controlPoints.data();
+    float step = 1.0f / mesh.level;
+
+    for (int i = 0; i < mesh.level; ++i) {
+        for (int j = 0; j < mesh.level; ++j) {
             float u0 = i * step, v0 = j * step;
             float u1 = (i + 1) * step, v1 = (j + 1) * step;
 
-            vec3 p00 = evaluateBezierPatch(u0, v0);
-            vec3 p10 = evaluateBezierPatch(u1, v0);
-            vec3 p01 = evaluateBezierPatch(u0, v1);
-            vec3 p11 = evaluateBezierPatch(u1, v1);
+            vec3 p00 = evaluateBezierPatch(cp, u0, v0);
+            vec3 p10 = evaluateBezierPatch(cp, u1, v0);
+            vec3 p01 = evaluateBezierPatch(cp, u0, v1);
+            vec3 p11 = evaluateBezierPatch(cp, u1, v1);
 
             vec3 n1 = normalize(cross(p10 - p00, p01 - p00));
-            patchVertices.push_back(p00); patchVertices.push_back(n1);
-            patchVertices.push_back(p10); patchVertices.push_back(n1);
-            patchVertices.push_back(p01); patchVertices.push_back(n1);
+            mesh.vertices.push_back(p00); mesh.vertices.push_back(n1);
+            mesh.vertices.push_back(p10); mesh.vertices.push_back(n1);
+            mesh.vertices.push_back(p01); mesh.vertices.push_back(n1);
             
             vec3 n2 = normalize(cross(p10 - p11, p01 - p11));
-            patchVertices.push_back(p10); patchVertices.push_back(n2);
-            patchVertices.push_back(p11); patchVertices.push_back(n2);
-            patchVertices.push_back(p01); patchVertices.push_back(n2);
+            mesh.vertices.push_back(p10); mesh.vertices.push_back(n2);
+            mesh.vertices.push_back(p11); mesh.vertices.push_back(n2);
+            mesh.vertices.push_back(p01); mesh.vertices.push_back(n2);
         }
     }
+}
 
-    glBindVertexArray(patchVAO);
-    glBindBuffer(GL_ARRAY_BUFFER, patchVBO);
-    glBufferData(GL_ARRAY_BUFFER, patchVertices.size() * sizeof(vec3), patchVertices.data(), GL_DYNAMIC_DRAW);
-    glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 6 * sizeof(float), (void*)0);
-    glEnableVertexAttribArray(0);
-    glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, 6 * sizeof(float), (void*)(3 * sizeof(float)));
-    glEnableVertexAttribArray(1);
+void tessellatePatchGridForwardDiff(PatchMesh& mesh) {
+    int n = mesh.level;
+    mesh.grid.resize((n + 1) * (n + 1));
+    tessellateGridForwardDiff(mesh.controlPoints.data(), n, mesh.grid.data());
+}
 
-    glBindVertexArray(controlPointsVAO);
-    glBindBuffer(GL_ARRAY_BUFFER, controlPointsVBO);
-    glBufferData(GL_ARRAY_BUFFER, controlPoints.size() * sizeof(vec3), controlPoints.data(), GL_DYNAMIC_DRAW);
-    glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 3 * sizeof(float), (void*)0);
-    glEnableVertexAttribArray(0);
+void buildPatchTrianglesForwardDiff(PatchMesh& mesh) {
+    int n = mesh.level;
+    tessellatePatchGridForwardDiff(mesh);
+
+    for (int i = 0; i < n; ++i) {
+        for (int j = 0; j < n; ++j) {
+            const vec3& p00 = mesh.grid[i * (n + 1) + j];
+            const vec3& p01 = mesh.grid[i * (n + 1) + j + 1];
+            const vec3& p10 = mesh.grid[(i + 1) * (n + 1) + j];
+            const vec3& p11 = mesh.grid[(i + 1) * (n + 1) + j + 1];
+
+            vec3 n1 = normalize(cross(p10 - p00, p01 - p00));
+            mesh.vertices.push_back(p00); mesh.vertices.push_back(n1);
+            mesh.vertices.push_back(p10); mesh.vertices.push_back(n1);
+            mesh.vertices.push_back(p01); mesh.vertices.push_back(n1);
+
+            vec3 n2 = normalize(cross(p10 - p11, p01 - p11));
+            mesh.vertices.push_back(p10); mesh.vertices.push_back(n2);
+            mesh.vertices.push_back(p11); mesh.vertices.push_back(n2);
+            mesh.vertices.push_back(p01); mesh.vertices.push_back(n2);
+        }
+    }
 }
 
-vec3 evaluateBezierCurve(const vec3& p0, const vec3& p1, const vec3& p2, const vec3& p3, float t) {
-    vec3 p01 = mix(p0, p1, t);
-    vec3 p12 = mix(p1, p2, t);
-    vec3 p23 = mix(p2, p3, t);
-    vec3 p012 = mix(p01, p12, t);
-    vec3 p123 = mix(p12, p23, t);
-    return mix(p012, p123, t);
+// Shared-vertex mode: (N+1)x(N+1) vertices plus an index buffer, with normals taken from
+// the analytic partial derivatives instead of the faces, so the patch shades smoothly.
+void buildPatchIndexedGrid(PatchMesh& mesh) {
+    const vec3* cp = mesh.controlPoints.data();
+    int n = mesh.level;
+    float step = 1.0f / n;
+    if (mesh.forwardDifferencing) tessellatePatchGridForwardDiff(mesh);
+
+    mesh.vertices.reserve((n + 1) * (n + 1) * 2);
+    for (int i = 0; i <= n; ++i) {
+        for (int j = 0; j <= n; ++j) {
+            float u = i * step, v = j * step;
+            mesh.vertices.push_back(mesh.forwardDifferencing ? mesh.grid[i * (n + 1) + j] : evaluateBezierPatch(cp, u, v));
+            mesh.vertices.push_back(evaluateBezierPatchNormal(cp, u, v));
+        }
+    }
+
+    mesh.indices.clear();
+    mesh.indices.reserve(n * n * 6);
+    for (int i = 0; i < n; ++i) {
+        for (int j = 0; j < n; ++j) {
+            GLuint i00 = i * (n + 1) + j, i01 = i00 + 1;
+            GLuint i10 = i00 + (n + 1), i11 = i10 + 1;
+            mesh.indices.insert(mesh.indices.end(), {i00, i10, i01, i10, i11, i01});
+        }
+    }
 }
 
-vec3 evaluateBezierPatch(float u, float v) {
-    vec3 v_curve_points[4];
-    for (int i = 0; i < 4; ++i) {
-        v_curve_points[i] = evaluateBezierCurve(
-            controlPoints[i * 4 + 0], controlPoints[i * 4 + 1],
-            controlPoints[i * 4 + 2], controlPoints[i * 4 + 3], u);
+// Screen-space adaptive mesh. Every tile edge gets a power-of-two level from the projected
+// length of the edge curve, and a tile is gridded at the finest of its four edge levels.
+// Vertices on a tile border snap to the sampling of that border's edge level, and all
+// vertices are keyed on one global (u,v) lattice, so neighbouring tiles share the exact
+// same border vertices and the mesh stays crack-free across level changes. Works only from
+// the snapshot in `mesh`, so it can run on the tessellation worker like the other CPU meshes.
+void buildPatchAdaptive(PatchMesh& mesh) {
+    const int M = adaptiveTiles, latticeSize = adaptiveTiles * adaptiveMaxLevel;
+    const vec3* cp = mesh.controlPoints.data();
+
+    auto toScreen = [&](float u, float v) {
+        vec4 clip = mesh.viewProjection * vec4(evaluateBezierPatch(cp, u, v), 1.0f);
+        float w = glm::max(clip.w, 1e-4f);
+        return vec2((clip.x / w * 0.5f + 0.5f) * mesh.viewportSize.x, (clip.y / w * 0.5f + 0.5f) * mesh.viewportSize.y);
+    };
+    // Projected length of a tile edge curve, sampled as a 3-segment polyline.
+    auto edgeLevel = [&](float u0, float v0, float u1, float v1) {
+        float pixels = 0.0f;
+        vec2 prev = toScreen(u0, v0);
+        for (int s = 1; s <= 3; ++s) {
+            vec2 next = toScreen(mix(u0, u1, s / 3.0f), mix(v0, v1, s / 3.0f));
+            pixels += length(next - prev);
+            prev = next;
+        }
+        int level = 1;
+        while (level < adaptiveMaxLevel && level * mesh.pixelsPerSegment < pixels) level *= 2;
+        return level;
+    };
+
+    // alongU[line][tile]: edge at v = line/M spanning tile in u; alongV likewise with u fixed.
+    vector<int> alongU((M + 1) * M), alongV((M + 1) * M);
+    for (int line = 0; line <= M; ++line) {
+        for (int t = 0; t < M; ++t) {
+            alongU[line * M + t] = edgeLevel((float)t / M, (float)line / M, (float)(t + 1) / M, (float)line / M);
+            alongV[line * M + t] = edgeLevel((float)line / M, (float)t / M, (float)line / M, (float)(t + 1) / M);
+        }
+    }
+
+    unordered_map<long long, GLuint> latticeIndex;
+    auto vertexAt = [&](int gu, int gv) {
+        long long key = (long long)gu * (latticeSize + 1) + gv;
+        auto it = latticeIndex.find(key);
+        if (it != latticeIndex.end()) return it->second;
+        float u = (float)gu / latticeSize, v = (float)gv / latticeSize;
+        GLuint index = mesh.vertices.size() / 2;
+        mesh.vertices.push_back(evaluateBezierPatch(cp, u, v));
+        mesh.vertices.push_back(evaluateBezierPatchNormal(cp, u, v));
+        latticeIndex.emplace(key, index);
+        return index;
+    };
+    auto snap = [](int i, int level, int edge) {
+        int stride = level / edge;
+        return ((i + stride / 2) / stride) * stride;
+    };
+
+    mesh.indices.clear();
+    vector<GLuint> tile;
+    for (int ti = 0; ti < M; ++ti) {
+        for (int tj = 0; tj < M; ++tj) {
+            int uLow = alongU[tj * M + ti], uHigh = alongU[(tj + 1) * M + ti];
+            int vLow = alongV[ti * M + tj], vHigh = alongV[(ti + 1) * M + tj];
+            int L = glm::max(glm::max(uLow, uHigh), glm::max(vLow, vHigh));
+            int scale = adaptiveMaxLevel / L;
+
+            tile.assign((L + 1) * (L + 1), 0);
+            for (int i = 0; i <= L; ++i) {
+                for (int j = 0; j <= L; ++j) {
+                    int si = i, sj = j;
+                    if (j == 0) si = snap(i, L, uLow);
+                    else if (j == L) si = snap(i, L, uHigh);
+                    if (i == 0) sj = snap(j, L, vLow);
+                    else if (i == L) sj = snap(j, L, vHigh);
+                    tile[i * (L + 1) + j] = vertexAt(ti * adaptiveMaxLevel + si * scale, tj * adaptiveMaxLevel + sj * scale);
+                }
+            }
+            for (int i = 0; i < L; ++i) {
+                for (int j = 0; j < L; ++j) {
+                    GLuint i00 = tile[i * (L + 1) + j], i01 = tile[i * (L + 1) + j + 1];
+                    GLuint i10 = tile[(i + 1) * (L + 1) + j], i11 = tile[(i + 1) * (L + 1) + j + 1];
+                    // Snapping collapses some border triangles; drop them instead of drawing slivers.
+                    if (i00 != i10 && i10 != i01 && i01 != i00) mesh.indices.insert(mesh.indices.end(), {i00, i10, i01});
+                    if (i10 != i11 && i11 != i01 && i01 != i10) mesh.indices.insert(mesh.indices.end(), {i10, i11, i01});
+                }
+            }
+        }
     }
-    return evaluateBezierCurve(v_curve_points[0], v_curve_points[1], v_curve_points[2], v_curve_points[3], v);
 }
 
 void framebuffer_size_callback(GLFWwindow* window, int width, int height) {
@@ -295,3 +1249,39 @@ GLuint makeProgram(const string& vertexPath, const string& fragmentPath) {
     glDeleteShader(v); glDeleteShader(f);
     return prog;
 }
+
+GLuint makeTessellationProgram(const string& vertexPath, const string& controlPath, const string& evaluationPath, const string& fragmentPath) {
+    string vCode = loadShaderFromFile(vertexPath);
+    string tcCode = loadShaderFromFile(controlPath);
+    string teCode = loadShaderFromFile(evaluationPath);
+    string fCode = loadShaderFromFile(fragmentPath);
+    GLuint v = compileShader(GL_VERTEX_SHADER, vCode.c_str());
+    GLuint tc = compileShader(GL_TESS_CONTROL_SHADER, tcCode.c_str());
+    GLuint te = compileShader(GL_TESS_EVALUATION_SHADER, teCode.c_str());
+    GLuint f = compileShader(GL_FRAGMENT_SHADER, fCode.c_str());
+    GLuint prog = glCreateProgram();
+    glAttachShader(prog, v);
+    glAttachShader(prog, tc);
+    glAttachShader(prog, te);
+    glAttachShader(prog, f);
+    glLinkProgram(prog);
+    GLint ok;
+    glGetProgramiv(prog, GL_LINK_STATUS, &ok);
+    if (!ok) { char log[512]; glGetProgramInfoLog(prog, 512, NULL, log); cerr << "Shader Link Error: " << log << endl; }
+    glDeleteShader(v); glDeleteShader(tc); glDeleteShader(te); glDeleteShader(f);
+    return prog;
+}
+
+// Returns 0 if the compute program fails to link.
+GLuint makeComputeProgram(const string& computePath) {
+    string cCode = loadShaderFromFile(computePath);
+    GLuint c = compileShader(GL_COMPUTE_SHADER, cCode.c_str());
+    GLuint prog = glCreateProgram();
+    glAttachShader(prog, c);
+    glLinkProgram(prog);
+    GLint ok;
+    glGetProgramiv(prog, GL_LINK_STATUS, &ok);
+    if (!ok) { char log[512]; glGetProgramInfoLog(prog, 512, NULL, log); cerr << "Shader Link Error: " << log << endl; glDeleteProgram(prog); prog = 0; }
+    glDeleteShader(c);
+    return prog;
+}
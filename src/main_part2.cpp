@@ -4,6 +4,7 @@
 #include <glm/gtc/matrix_transform.hpp>
 #include <glm/gtc/type_ptr.hpp>
 #include <cmath>
+#include <cfloat>
 
 #include <iostream>
 #include <vector>
@@ -13,16 +14,24 @@
 #include <map>
 #include <algorithm>
 
+#include "pick_readback.h"
+#include "object_bvh.h"
+#include "thread_pool.h"
+
 using namespace std;
 using namespace glm;
 
 // --- Structs ---
+// An object's picking ID is its index in sceneObjects plus one; 0 is the background.
 struct SceneObject {
+    int mesh = 0;                       // index into meshVertices / meshVAOs
     GLuint VAO = 0;
     int vertexCount = 0;
     mat4 modelMatrix = mat4(1.0f);
     vec3 diffuseColor = vec3(1.0f);
-    vec3 pickingColor = vec3(0.0f);
+    bool selected = false;              // in the last marquee selection
+    vec3 boundsCenter = vec3(0.0f);     // world-space bounding sphere
+    float boundsRadius = 0.0f;
 };
 
 // --- Function Prototypes ---
@@ -36,11 +45,28 @@ void setupFBO();
 void generateSphere(vector<float>& vertices, float radius, int sectorCount, int stackCount);
 void generateSmoothCube(vector<float>& vertices, float size);
 void generateCone(vector<float>& vertices, float radius, float height, int sectorCount);
-void performPicking(double mouseX, double mouseY);
+void performPicking(double mouseX, double mouseY, AsyncPickReadback::Callback onPicked);
+size_t drawPickRegion(int x, int y, int width, int height);
+void performMarqueeSelection(double x0, double y0, double x1, double y1);
+void applyMarqueeSelection(const GLuint* ids, int width, int height, double releaseTime, unsigned long releaseFrame);
+vector<pair<GLuint, unsigned>> histogramIDs(const GLuint* ids, size_t count);
+void mergeIDCounts(vector<pair<GLuint, unsigned>>& entries);
+void drawMarqueeOutline(GLFWwindow* window);
+void recolorPickedObject(GLuint pickedID, double clickTime, unsigned long clickFrame);
+vec3 cameraMatrices(mat4& view, mat4& projection);
+void buildSceneBVH();
+GLuint rayCastPick(double mouseX, double mouseY);
+bool rayHitsObject(const SceneObject& obj, const vec3& origin, const vec3& dir, float tMax, float& tHit);
+SceneObject makeSceneObject(int mesh, const mat4& modelMatrix, const vec3& color);
+void addObjectLattice(int count);
+void extractFrustumPlanes(const mat4& viewProjection, vec4 planes[6]);
+bool sphereInFrustum(const vec4 planes[6], const vec3& center, float radius);
 
 // --- Global State ---
 int windowWidth = 800, windowHeight = 600;
 bool antiAliasing = false;
+bool regionPicking = true; // P: rasterize only the cursor's pixel / redraw the whole picking FBO
+bool cpuPicking = false;   // C: ray-cast against sceneBVH and the meshes instead of the GPU pass
 
 // --- Shaders ---
 GLuint smoothPhongShader, pickingShader;
@@ -50,11 +76,32 @@ float camAngle = 20.0f, camPitch = 20.0f, camDist = 10.0f;
 vec3 lookAtPoint = vec3(0.0f, 0.0f, 0.0f);
 
 // --- Scene Data ---
+// The picking FBO has a GL_R32UI colour attachment holding each pixel's object ID.
 GLuint pickingFBO = 0, pickingTexture = 0;
 GLuint depthRenderbuffer = 0;
-map<int, SceneObject> sceneObjects;
-
-int main() {
+vector<SceneObject> sceneObjects;
+// Picks are read back through fenced PBOs and delivered a frame or two after the click.
+AsyncPickReadback pickReadback;
+unsigned long frameIndex = 0;
+// Sphere, cube and cone. meshVertices keeps the position/normal triangles for CPU ray
+// picking; meshRadii and meshBoundsLo/Hi bound each mesh around its origin.
+vector<float> meshVertices[3];
+GLuint meshVAOs[3];
+int meshVertexCounts[3];
+float meshRadii[3];
+vec3 meshBoundsLo[3], meshBoundsHi[3];
+ObjectBVH sceneBVH;
+
+// --- Marquee Selection ---
+// A left drag of at least marqueeMinPixels selects every object with a visible pixel inside
+// the rectangle; a shorter one is a click pick.
+const double marqueeMinPixels = 4.0;
+bool marqueeDragging = false;
+double marqueeStartX = 0.0, marqueeStartY = 0.0;
+ThreadPool histogramPool;
+vector<vector<pair<GLuint, unsigned>>> histogramBands; // per-band (ID, pixels), kept between selections
+
+int main(int argc, char** argv) {
     srand(time(NULL));
     if (!glfwInit()) return -1;
     glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 3);
@@ -73,74 +120,73 @@ int main() {
     glEnable(GL_DEPTH_TEST);
 
     smoothPhongShader = makeProgram("shaders/smooth_phong.vert", "shaders/smooth_phong.frag");
-    pickingShader = makeProgram("shaders/picking.vert", "shaders/picking.frag");
-
-    sceneObjects[1] = SceneObject();
-    sceneObjects[2] = SceneObject();
-    sceneObjects[3] = SceneObject();
-
-    sceneObjects[1].modelMatrix = translate(mat4(1.0f), vec3(-2.5, 0, 0));
-    sceneObjects[1].diffuseColor = vec3(0.8, 0.2, 0.2);
-    sceneObjects[1].pickingColor = vec3(1.0, 0.0, 0.0);
-
-    sceneObjects[2].modelMatrix = translate(mat4(1.0f), vec3(0, 0, 0));
-    sceneObjects[2].diffuseColor = vec3(0.2, 0.8, 0.2);
-    sceneObjects[2].pickingColor = vec3(0.0, 1.0, 0.0);
+    pickingShader = makeProgram("shaders/picking.vert", "shaders/picking.frag"); // its only output, pickID, is location 0
 
-    sceneObjects[3].modelMatrix = translate(mat4(1.0f), vec3(2.5, -0.5, 0));
-    sceneObjects[3].diffuseColor = vec3(0.2, 0.2, 0.8);
-    sceneObjects[3].pickingColor = vec3(0.0, 0.0, 1.0);
+    generateSphere(meshVertices[0], 0.8f, 36, 18);
+    generateSmoothCube(meshVertices[1], 1.2f);
+    generateCone(meshVertices[2], 0.7f, 1.5f, 36);
 
-    vector<float> sphereVertices, cubeVertices, coneVertices;
-    generateSphere(sphereVertices, 0.8f, 36, 18);
-    generateSmoothCube(cubeVertices, 1.2f);
-    generateCone(coneVertices, 0.7f, 1.5f, 36);
-    
-    for (auto const& [id, obj] : sceneObjects) {
-        glGenVertexArrays(1, &sceneObjects[id].VAO);
+    // One VAO per shape, shared by every object of that shape.
+    glGenVertexArrays(3, meshVAOs);
+    for (int m = 0; m < 3; ++m) {
+        const vector<float>& vertices = meshVertices[m];
         GLuint VBO;
         glGenBuffers(1, &VBO);
-        glBindVertexArray(sceneObjects[id].VAO);
+        glBindVertexArray(meshVAOs[m]);
         glBindBuffer(GL_ARRAY_BUFFER, VBO);
-        if (id == 1) {
-            glBufferData(GL_ARRAY_BUFFER, sphereVertices.size() * sizeof(float), sphereVertices.data(), GL_STATIC_DRAW);
-            sceneObjects[id].vertexCount = sphereVertices.size() / 6;
-        } else if (id == 2) {
-            glBufferData(GL_ARRAY_BUFFER, cubeVertices.size() * sizeof(float), cubeVertices.data(), GL_STATIC_DRAW);
-            sceneObjects[id].vertexCount = cubeVertices.size() / 6;
-        } else {
-            glBufferData(GL_ARRAY_BUFFER, coneVertices.size() * sizeof(float), coneVertices.data(), GL_STATIC_DRAW);
-            sceneObjects[id].vertexCount = coneVertices.size() / 6;
+        glBufferData(GL_ARRAY_BUFFER, vertices.size() * sizeof(float), vertices.data(), GL_STATIC_DRAW);
+        meshVertexCounts[m] = vertices.size() / 6;
+        meshRadii[m] = 0.0f;
+        meshBoundsLo[m] = vec3(FLT_MAX);
+        meshBoundsHi[m] = vec3(-FLT_MAX);
+        for (size_t v = 0; v < vertices.size(); v += 6) {
+            vec3 p(vertices[v], vertices[v + 1], vertices[v + 2]);
+            meshRadii[m] = glm::max(meshRadii[m], length(p));
+            meshBoundsLo[m] = glm::min(meshBoundsLo[m], p);
+            meshBoundsHi[m] = glm::max(meshBoundsHi[m], p);
         }
         glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 6 * sizeof(float), (void*)0);
         glEnableVertexAttribArray(0);
         glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, 6 * sizeof(float), (void*)(3 * sizeof(float)));
         glEnableVertexAttribArray(1);
     }
-    
+
+    const vec3 positions[3] = { vec3(-2.5, 0, 0), vec3(0, 0, 0), vec3(2.5, -0.5, 0) };
+    const vec3 colors[3] = { vec3(0.8, 0.2, 0.2), vec3(0.2, 0.8, 0.2), vec3(0.2, 0.2, 0.8) };
+    for (int m = 0; m < 3; ++m) sceneObjects.push_back(makeSceneObject(m, translate(mat4(1.0f), positions[m]), colors[m]));
+    if (argc > 1) addObjectLattice(atoi(argv[1]));
+
+    double bvhStart = glfwGetTime();
+    buildSceneBVH();
+    double bvhMs = (glfwGetTime() - bvhStart) * 1000.0;
+
     setupFBO();
+    pickReadback.init();
 
     cout << "--- Assignment 4, Part 2: Picking ---\n"
          << "Controls:\n"
          << "  ESC: Close Window\n"
          << "  Click: Pick an object to change its color\n"
+         << "  Left Drag: Select every visible object in the rectangle\n"
          << "  A: Toggle Anti-aliasing\n"
+         << "  P: Toggle 1x1 Pick-Region / Full-Viewport Picking Pass\n"
+         << "  C: Toggle CPU Ray-Cast (BVH) / GPU Picking\n"
          << "  W/S/D/Q: Camera Control\n"
          << "  Z/X: Camera Zoom\n"
-         << "  R: Reset View\n";
+         << "  R: Reset View\n"
+         << "Pickable objects: " << sceneObjects.size() << "\n"
+         << "Pick readback: " << (pickReadback.usesFences() ? "PBO + fence" : "PBO, read " + to_string(AsyncPickReadback::kFallbackFrames) + " frames later (no ARB_sync)") << "\n"
+         << "Object BVH: " << sceneBVH.nodeCount() << " nodes, built in " << bvhMs << " ms\n";
 
     while (!glfwWindowShouldClose(window)) {
+        pickReadback.poll();
         if (antiAliasing) glEnable(GL_MULTISAMPLE); else glDisable(GL_MULTISAMPLE);
         
         glClearColor(0.1f, 0.1f, 0.1f, 1.0f);
         glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
 
-        float camX = camDist * cos(radians(camAngle)) * cos(radians(camPitch));
-        float camY = camDist * sin(radians(camPitch));
-        float camZ = camDist * sin(radians(camAngle)) * cos(radians(camPitch));
-        vec3 camPos = lookAtPoint + vec3(camX, camY, camZ);
-        mat4 view = lookAt(camPos, lookAtPoint, vec3(0.0, 1.0, 0.0));
-        mat4 projection = perspective(radians(45.0f), (float)windowWidth / (float)windowHeight, 0.1f, 100.0f);
+        mat4 view, projection;
+        vec3 camPos = cameraMatrices(view, projection);
 
         glUseProgram(smoothPhongShader);
         glUniformMatrix4fv(glGetUniformLocation(smoothPhongShader, "view"), 1, GL_FALSE, value_ptr(view));
@@ -148,14 +194,18 @@ int main() {
         glUniform3fv(glGetUniformLocation(smoothPhongShader, "lightPos"), 1, value_ptr(camPos));
         glUniform3f(glGetUniformLocation(smoothPhongShader, "lightColor"), 1.0f, 1.0f, 1.0f);
 
-        for (auto const& [id, obj] : sceneObjects) {
+        for (const SceneObject& obj : sceneObjects) {
             glUniformMatrix4fv(glGetUniformLocation(smoothPhongShader, "model"), 1, GL_FALSE, value_ptr(obj.modelMatrix));
-            glUniform3fv(glGetUniformLocation(smoothPhongShader, "objectColor"), 1, value_ptr(obj.diffuseColor));
+            vec3 color = obj.selected ? mix(obj.diffuseColor, vec3(1.0f, 1.0f, 0.0f), 0.6f) : obj.diffuseColor;
+            glUniform3fv(glGetUniformLocation(smoothPhongShader, "objectColor"), 1, value_ptr(color));
             glBindVertexArray(obj.VAO);
             glDrawArrays(GL_TRIANGLES, 0, obj.vertexCount);
         }
 
+        if (marqueeDragging) drawMarqueeOutline(window);
+
         glfwSwapBuffers(window);
+        ++frameIndex;
         glfwPollEvents();
     }
     glfwTerminate();
@@ -171,6 +221,14 @@ void key_callback(GLFWwindow* window, int key, int, int action, int) {
     if (action != GLFW_PRESS && action != GLFW_REPEAT) return;
 
     if (key == GLFW_KEY_A) { antiAliasing = !antiAliasing; cout << "Anti-aliasing: " << (antiAliasing ? "ON" : "OFF") << endl; }
+    if (key == GLFW_KEY_C && action == GLFW_PRESS) {
+        cpuPicking = !cpuPicking;
+        cout << "Picking: " << (cpuPicking ? "CPU ray cast (BVH)" : "GPU picking pass") << endl;
+    }
+    if (key == GLFW_KEY_P && action == GLFW_PRESS) {
+        regionPicking = !regionPicking;
+        cout << "Picking pass: " << (regionPicking ? "1x1 pick region" : "full viewport") << endl;
+    }
     
     if (key == GLFW_KEY_W) camPitch = glm::min(89.0f, camPitch + 2.0f);
     if (key == GLFW_KEY_S) camPitch = glm::max(-89.0f, camPitch - 2.0f);
@@ -183,53 +241,326 @@ void key_callback(GLFWwindow* window, int key, int, int action, int) {
 
 void mouse_button_callback(GLFWwindow* window, int button, int action, int mods) {
     if (button == GLFW_MOUSE_BUTTON_LEFT && action == GLFW_PRESS) {
+        glfwGetCursorPos(window, &marqueeStartX, &marqueeStartY);
+        marqueeDragging = true;
+    }
+    if (button == GLFW_MOUSE_BUTTON_LEFT && action == GLFW_RELEASE && marqueeDragging) {
+        marqueeDragging = false;
         double xpos, ypos;
         glfwGetCursorPos(window, &xpos, &ypos);
-        performPicking(xpos, ypos);
+        if (fabs(xpos - marqueeStartX) >= marqueeMinPixels || fabs(ypos - marqueeStartY) >= marqueeMinPixels) {
+            performMarqueeSelection(marqueeStartX, marqueeStartY, xpos, ypos);
+            return;
+        }
+        double clickTime = glfwGetTime();
+        unsigned long clickFrame = frameIndex;
+        if (cpuPicking) recolorPickedObject(rayCastPick(xpos, ypos), clickTime, clickFrame);
+        else performPicking(xpos, ypos, [clickTime, clickFrame](GLuint pickedID) { recolorPickedObject(pickedID, clickTime, clickFrame); });
     }
 }
 
-void performPicking(double mouseX, double mouseY) {
+void recolorPickedObject(GLuint pickedID, double clickTime, unsigned long clickFrame) {
+    if (pickedID == 0 || pickedID > sceneObjects.size()) return;
+    cout << "Picked object with ID: " << pickedID << " (" << frameIndex - clickFrame << " frames, "
+         << (glfwGetTime() - clickTime) * 1000.0 << " ms after the click)" << endl;
+    sceneObjects[pickedID - 1].diffuseColor = vec3((rand() % 100) / 100.0f, (rand() % 100) / 100.0f, (rand() % 100) / 100.0f);
+}
+
+// With regionPicking only the cursor's pixel is drawn (see drawPickRegion); otherwise the
+// whole viewport is. The ID is copied into a PBO and handed to onPicked once
+// pickReadback.poll() finds the copy finished.
+void performPicking(double mouseX, double mouseY, AsyncPickReadback::Callback onPicked) {
+    int pickX = (int)mouseX, pickY = windowHeight - (int)mouseY - 1;
+    if (pickX < 0 || pickY < 0 || pickX >= windowWidth || pickY >= windowHeight) return;
+    double start = glfwGetTime();
+
     glBindFramebuffer(GL_FRAMEBUFFER, pickingFBO);
+    size_t submitted;
+    int readX = 0, readY = 0;
+    if (regionPicking) {
+        submitted = drawPickRegion(pickX, pickY, 1, 1);
+    } else {
+        submitted = drawPickRegion(0, 0, windowWidth, windowHeight);
+        readX = pickX;
+        readY = pickY;
+    }
+
+    glReadBuffer(GL_COLOR_ATTACHMENT0);
+    bool queued = pickReadback.request(readX, readY, onPicked);
+
+    glDisable(GL_SCISSOR_TEST);
+    glBindFramebuffer(GL_FRAMEBUFFER, 0);
     glViewport(0, 0, windowWidth, windowHeight);
-    
-    glClearColor(0.0f, 0.0f, 0.0f, 1.0f);
-    glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+    if (antiAliasing) glEnable(GL_MULTISAMPLE);
+
+    if (!queued) { cout << "Pick dropped: " << AsyncPickReadback::kSlots << " readbacks already in flight" << endl; return; }
+    cout << "Pick (" << (regionPicking ? "1x1 region" : "full viewport") << ") submitted in " << (glfwGetTime() - start) * 1000.0 << " ms, "
+         << submitted << " of " << sceneObjects.size() << " objects drawn" << endl;
+}
+
+// Draws the IDs seen through the window rectangle (x, y, width, height) into the lower-left
+// width x height pixels of the bound picking FBO. The projection is narrowed to the rectangle
+// as gluPickMatrix does, and the viewport and scissor cover only those pixels, so nothing
+// outside them is cleared or rasterized. Objects whose bounding sphere misses the narrowed
+// frustum are not submitted. Returns how many were drawn; leaves the scissor test enabled.
+size_t drawPickRegion(int x, int y, int width, int height) {
+    mat4 view, projection;
+    cameraMatrices(view, projection);
+    vec3 offset((windowWidth - 2.0f * x - width) / width, (windowHeight - 2.0f * y - height) / height, 0.0f);
+    vec3 zoom((float)windowWidth / width, (float)windowHeight / height, 1.0f);
+    projection = scale(translate(mat4(1.0f), offset), zoom) * projection;
+    glViewport(0, 0, width, height);
+    glScissor(0, 0, width, height);
+    glEnable(GL_SCISSOR_TEST);
+
+    // Integer attachments are cleared with glClearBuffer; ID 0 marks the background.
+    const GLuint background[4] = { 0, 0, 0, 0 };
+    glClearBufferuiv(GL_COLOR, 0, background);
+    glClear(GL_DEPTH_BUFFER_BIT);
     glDisable(GL_MULTISAMPLE);
 
     glUseProgram(pickingShader);
-    float camX = camDist * cos(radians(camAngle)) * cos(radians(camPitch));
-    float camY = camDist * sin(radians(camPitch));
-    float camZ = camDist * sin(radians(camAngle)) * cos(radians(camPitch));
-    vec3 camPos = lookAtPoint + vec3(camX, camY, camZ);
-    mat4 view = lookAt(camPos, lookAtPoint, vec3(0.0, 1.0, 0.0));
-    mat4 projection = perspective(radians(45.0f), (float)windowWidth / (float)windowHeight, 0.1f, 100.0f);
     glUniformMatrix4fv(glGetUniformLocation(pickingShader, "view"), 1, GL_FALSE, value_ptr(view));
     glUniformMatrix4fv(glGetUniformLocation(pickingShader, "projection"), 1, GL_FALSE, value_ptr(projection));
 
-    for (auto const& [id, obj] : sceneObjects) {
-        glUniformMatrix4fv(glGetUniformLocation(pickingShader, "model"), 1, GL_FALSE, value_ptr(obj.modelMatrix));
-        glUniform3fv(glGetUniformLocation(pickingShader, "pickingColor"), 1, value_ptr(obj.pickingColor));
+    vec4 planes[6];
+    extractFrustumPlanes(projection * view, planes);
+    GLint modelLocation = glGetUniformLocation(pickingShader, "model");
+    GLint idLocation = glGetUniformLocation(pickingShader, "objectID");
+    size_t submitted = 0;
+    for (size_t i = 0; i < sceneObjects.size(); ++i) {
+        const SceneObject& obj = sceneObjects[i];
+        if (!sphereInFrustum(planes, obj.boundsCenter, obj.boundsRadius)) continue;
+        glUniformMatrix4fv(modelLocation, 1, GL_FALSE, value_ptr(obj.modelMatrix));
+        glUniform1ui(idLocation, (GLuint)(i + 1));
         glBindVertexArray(obj.VAO);
         glDrawArrays(GL_TRIANGLES, 0, obj.vertexCount);
+        ++submitted;
     }
+    return submitted;
+}
+
+// One ID pass over the dragged rectangle and one asynchronous readback of all its pixels;
+// applyMarqueeSelection reduces them when they arrive.
+void performMarqueeSelection(double x0, double y0, double x1, double y1) {
+    int left = glm::clamp((int)glm::min(x0, x1), 0, windowWidth - 1);
+    int right = glm::clamp((int)glm::max(x0, x1), 0, windowWidth - 1);
+    int bottom = windowHeight - 1 - glm::clamp((int)glm::max(y0, y1), 0, windowHeight - 1);
+    int top = windowHeight - 1 - glm::clamp((int)glm::min(y0, y1), 0, windowHeight - 1);
+    int width = right - left + 1, height = top - bottom + 1;
+    double releaseTime = glfwGetTime();
+    unsigned long releaseFrame = frameIndex;
 
+    glBindFramebuffer(GL_FRAMEBUFFER, pickingFBO);
+    size_t submitted = drawPickRegion(left, bottom, width, height);
     glReadBuffer(GL_COLOR_ATTACHMENT0);
-    unsigned char pixel[4];
-    glReadPixels(mouseX, windowHeight - mouseY -1, 1, 1, GL_RGBA, GL_UNSIGNED_BYTE, pixel);
+    bool queued = pickReadback.requestRegion(0, 0, width, height, [releaseTime, releaseFrame](const GLuint* ids, int w, int h) {
+        applyMarqueeSelection(ids, w, h, releaseTime, releaseFrame);
+    });
 
+    glDisable(GL_SCISSOR_TEST);
     glBindFramebuffer(GL_FRAMEBUFFER, 0);
     glViewport(0, 0, windowWidth, windowHeight);
     if (antiAliasing) glEnable(GL_MULTISAMPLE);
 
-    int pickedID = 0;
-    if (pixel[0] == 255) pickedID = 1;
-    else if (pixel[1] == 255) pickedID = 2;
-    else if (pixel[2] == 255) pickedID = 3;
+    if (!queued) { cout << "Selection dropped: " << AsyncPickReadback::kSlots << " readbacks already in flight" << endl; return; }
+    cout << "Marquee " << width << "x" << height << " submitted, " << submitted << " of " << sceneObjects.size() << " objects drawn" << endl;
+}
+
+void applyMarqueeSelection(const GLuint* ids, int width, int height, double releaseTime, unsigned long releaseFrame) {
+    double start = glfwGetTime();
+    vector<pair<GLuint, unsigned>> coverage = histogramIDs(ids, (size_t)width * height);
+    double reduceMs = (glfwGetTime() - start) * 1000.0;
+
+    for (SceneObject& obj : sceneObjects) obj.selected = false;
+    for (const auto& [id, pixels] : coverage) sceneObjects[id - 1].selected = true;
+    sort(coverage.begin(), coverage.end(), [](const pair<GLuint, unsigned>& a, const pair<GLuint, unsigned>& b) { return a.second > b.second; });
+
+    cout << "Selected " << coverage.size() << " objects in " << width << "x" << height << " px (reduced in " << reduceMs << " ms on "
+         << histogramPool.size() << " threads, " << frameIndex - releaseFrame << " frames / " << (glfwGetTime() - releaseTime) * 1000.0
+         << " ms after release)";
+    for (size_t i = 0; i < coverage.size() && i < 5; ++i) cout << (i ? ", " : "; largest: ") << coverage[i].first << " (" << coverage[i].second << " px)";
+    cout << endl;
+}
+
+// Pixels per object ID, background excluded, in ascending ID order. Each row band is counted
+// on histogramPool into its own list: runs of equal IDs (objects cover neighbouring pixels)
+// become one entry, and the list is sorted and merged. The bands' lists are then merged the
+// same way, so the work follows the region's size and the IDs in it, not the scene's size.
+vector<pair<GLuint, unsigned>> histogramIDs(const GLuint* ids, size_t count) {
+    GLuint idRange = (GLuint)sceneObjects.size() + 1;
+    int bands = histogramPool.size();
+    size_t bandSize = (count + bands - 1) / bands;
+    histogramBands.resize(bands);
+    histogramPool.run(bands, [&](int band) {
+        vector<pair<GLuint, unsigned>>& local = histogramBands[band];
+        local.clear();
+        size_t end = glm::min(count, (band + 1) * bandSize);
+        for (size_t i = band * bandSize; i < end;) {
+            GLuint id = ids[i];
+            size_t runEnd = i + 1;
+            while (runEnd < end && ids[runEnd] == id) ++runEnd;
+            if (id != 0 && id < idRange) local.push_back({ id, (unsigned)(runEnd - i) });
+            i = runEnd;
+        }
+        mergeIDCounts(local);
+    });
+
+    vector<pair<GLuint, unsigned>> coverage;
+    for (const auto& local : histogramBands) coverage.insert(coverage.end(), local.begin(), local.end());
+    mergeIDCounts(coverage);
+    return coverage;
+}
+
+// Sorts (ID, pixels) entries by ID and folds equal IDs into one.
+void mergeIDCounts(vector<pair<GLuint, unsigned>>& entries) {
+    sort(entries.begin(), entries.end());
+    size_t out = 0;
+    for (size_t i = 0; i < entries.size(); ++i) {
+        if (out > 0 && entries[out - 1].first == entries[i].first) entries[out - 1].second += entries[i].second;
+        else entries[out++] = entries[i];
+    }
+    entries.resize(out);
+}
+
+// The rectangle being dragged, as four one-pixel scissored clears of the back buffer.
+void drawMarqueeOutline(GLFWwindow* window) {
+    double x, y;
+    glfwGetCursorPos(window, &x, &y);
+    int left = (int)glm::min(x, marqueeStartX), right = (int)glm::max(x, marqueeStartX);
+    int bottom = windowHeight - 1 - (int)glm::max(y, marqueeStartY), top = windowHeight - 1 - (int)glm::min(y, marqueeStartY);
+    int width = right - left + 1, height = top - bottom + 1;
+    glEnable(GL_SCISSOR_TEST);
+    glClearColor(1.0f, 1.0f, 0.0f, 1.0f);
+    const int edges[4][4] = { { left, bottom, width, 1 }, { left, top, width, 1 }, { left, bottom, 1, height }, { right, bottom, 1, height } };
+    for (const auto& edge : edges) {
+        glScissor(edge[0], edge[1], edge[2], edge[3]);
+        glClear(GL_COLOR_BUFFER_BIT);
+    }
+    glDisable(GL_SCISSOR_TEST);
+}
+
+// The camera the render loop and both picking paths share. Returns the eye position.
+vec3 cameraMatrices(mat4& view, mat4& projection) {
+    float camX = camDist * cos(radians(camAngle)) * cos(radians(camPitch));
+    float camY = camDist * sin(radians(camPitch));
+    float camZ = camDist * sin(radians(camAngle)) * cos(radians(camPitch));
+    vec3 camPos = lookAtPoint + vec3(camX, camY, camZ);
+    view = lookAt(camPos, lookAtPoint, vec3(0.0, 1.0, 0.0));
+    projection = perspective(radians(45.0f), (float)windowWidth / (float)windowHeight, 0.1f, 100.0f);
+    return camPos;
+}
+
+// World-space box of each object: its mesh's box corners moved by the model matrix. The
+// scene is static, so this runs once after the objects are created.
+void buildSceneBVH() {
+    vector<vec3> lo(sceneObjects.size()), hi(sceneObjects.size());
+    for (size_t i = 0; i < sceneObjects.size(); ++i) {
+        const SceneObject& obj = sceneObjects[i];
+        lo[i] = vec3(FLT_MAX);
+        hi[i] = vec3(-FLT_MAX);
+        for (int corner = 0; corner < 8; ++corner) {
+            vec3 local(corner & 1 ? meshBoundsHi[obj.mesh].x : meshBoundsLo[obj.mesh].x,
+                       corner & 2 ? meshBoundsHi[obj.mesh].y : meshBoundsLo[obj.mesh].y,
+                       corner & 4 ? meshBoundsHi[obj.mesh].z : meshBoundsLo[obj.mesh].z);
+            vec3 world = vec3(obj.modelMatrix * vec4(local, 1.0f));
+            lo[i] = glm::min(lo[i], world);
+            hi[i] = glm::max(hi[i], world);
+        }
+    }
+    sceneBVH.build(lo, hi);
+}
+
+// Unprojects the cursor to a ray from the near to the far plane and returns the picked ID
+// (index + 1, or 0) at once, with no GPU work or readback.
+GLuint rayCastPick(double mouseX, double mouseY) {
+    double start = glfwGetTime();
+    mat4 view, projection;
+    cameraMatrices(view, projection);
+    vec4 viewport(0.0f, 0.0f, windowWidth, windowHeight);
+    vec3 cursor((float)mouseX, (float)(windowHeight - mouseY), 0.0f);
+    vec3 nearPoint = unProject(cursor, view, projection, viewport);
+    cursor.z = 1.0f;
+    vec3 dir = unProject(cursor, view, projection, viewport) - nearPoint;
+
+    ObjectBVH::Stats stats;
+    float tHit;
+    int hit = sceneBVH.raycast(nearPoint, dir, [&](int object, float tMax, float& t) {
+        return rayHitsObject(sceneObjects[object], nearPoint, dir, tMax, t);
+    }, tHit, &stats);
+    cout << "Ray-cast pick: " << (glfwGetTime() - start) * 1000.0 << " ms, " << stats.nodesVisited << " BVH nodes, "
+         << stats.objectsTested << " of " << sceneObjects.size() << " objects tested against their triangles" << endl;
+    return hit + 1;
+}
+
+// Moller-Trumbore against every triangle of the object's mesh, in object space: the ray
+// parameter t is the same there because the model matrix is affine. Both faces count.
+bool rayHitsObject(const SceneObject& obj, const vec3& origin, const vec3& dir, float tMax, float& tHit) {
+    mat4 toObject = inverse(obj.modelMatrix);
+    vec3 o = vec3(toObject * vec4(origin, 1.0f)), d = vec3(toObject * vec4(dir, 0.0f));
+    const vector<float>& v = meshVertices[obj.mesh];
+    bool hit = false;
+    tHit = tMax;
+    for (size_t i = 0; i + 18 <= v.size(); i += 18) {
+        vec3 a(v[i], v[i + 1], v[i + 2]), b(v[i + 6], v[i + 7], v[i + 8]), c(v[i + 12], v[i + 13], v[i + 14]);
+        vec3 e1 = b - a, e2 = c - a, p = cross(d, e2);
+        float det = dot(e1, p);
+        if (fabs(det) < 1e-12f) continue;
+        float invDet = 1.0f / det;
+        vec3 s = o - a;
+        float u = dot(s, p) * invDet;
+        if (u < 0.0f || u > 1.0f) continue;
+        vec3 q = cross(s, e1);
+        float w = dot(d, q) * invDet;
+        if (w < 0.0f || u + w > 1.0f) continue;
+        float t = dot(e2, q) * invDet;
+        if (t >= 0.0f && t < tHit) { tHit = t; hit = true; }
+    }
+    return hit;
+}
+
+// Gribb-Hartmann: each clip plane is row 3 of the matrix plus or minus row 0, 1 or 2,
+// normalized so plane distances are in world units.
+void extractFrustumPlanes(const mat4& viewProjection, vec4 planes[6]) {
+    mat4 rows = transpose(viewProjection);
+    for (int axis = 0; axis < 3; ++axis) {
+        planes[axis * 2] = rows[3] + rows[axis];
+        planes[axis * 2 + 1] = rows[3] - rows[axis];
+    }
+    for (int p = 0; p < 6; ++p) planes[p] /= length(vec3(planes[p]));
+}
+
+bool sphereInFrustum(const vec4 planes[6], const vec3& center, float radius) {
+    for (int p = 0; p < 6; ++p) {
+        if (dot(vec3(planes[p]), center) + planes[p].w < -radius) return false;
+    }
+    return true;
+}
+
+// The mesh's bounding sphere moved by the model matrix and grown by its largest axis scale.
+SceneObject makeSceneObject(int mesh, const mat4& modelMatrix, const vec3& color) {
+    SceneObject obj;
+    obj.mesh = mesh;
+    obj.VAO = meshVAOs[mesh];
+    obj.vertexCount = meshVertexCounts[mesh];
+    obj.modelMatrix = modelMatrix;
+    obj.diffuseColor = color;
+    obj.boundsCenter = vec3(modelMatrix[3]);
+    float axisScale = glm::max(length(vec3(modelMatrix[0])), glm::max(length(vec3(modelMatrix[1])), length(vec3(modelMatrix[2]))));
+    obj.boundsRadius = meshRadii[mesh] * axisScale;
+    return obj;
+}
 
-    if (pickedID != 0) {
-        cout << "Picked object with ID: " << pickedID << endl;
-        sceneObjects[pickedID].diffuseColor = vec3((rand() % 100) / 100.0f, (rand() % 100) / 100.0f, (rand() % 100) / 100.0f);
+// Extra objects for large-scene picking: count small copies of the three shapes on a square
+// lattice below the main objects, cycling shape and colour.
+void addObjectLattice(int count) {
+    int side = (int)ceil(sqrt((double)count));
+    float spacing = 0.6f;
+    for (int i = 0; i < count; ++i) {
+        int m = i % 3;
+        vec3 position((i % side - side * 0.5f) * spacing, -2.5f, (i / side - side * 0.5f) * spacing);
+        mat4 model = scale(translate(mat4(1.0f), position), vec3(0.25f));
+        sceneObjects.push_back(makeSceneObject(m, model, vec3(0.3f + 0.2f * m, 0.5f, 0.8f - 0.2f * m)));
     }
 }
 
@@ -243,7 +574,7 @@ void setupFBO() {
 
     glGenTextures(1, &pickingTexture);
     glBindTexture(GL_TEXTURE_2D, pickingTexture);
-    glTexImage2D(GL_TEXTURE_2D, 0, GL_RGB, windowWidth, windowHeight, 0, GL_RGB, GL_UNSIGNED_BYTE, NULL);
+    glTexImage2D(GL_TEXTURE_2D, 0, GL_R32UI, windowWidth, windowHeight, 0, GL_RED_INTEGER, GL_UNSIGNED_INT, NULL);
     glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
     glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
     glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, pickingTexture, 0);
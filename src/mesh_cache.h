@@ -0,0 +1,115 @@
+// On-disk cache of tessellated meshes, one memory-mappable file per input key.
+//
+// The caller hashes everything the mesh depends on (control points, level, vertex format...)
+// into a 64-bit key with hashBytes(); the key names the file and is repeated in its header.
+// Changed inputs give a new key, so stale entries are never read and need no explicit
+// invalidation; deleting the directory clears the cache.
+//
+// File layout: MeshCacheHeader, then vertexBytes of vertex data, then indexCount 32-bit
+// indices. The header is 32 bytes and vertex data is a multiple of 4 bytes, so both arrays
+// can be used in place from the mapping.
+#pragma once
+
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <string>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+// FNV-1a; chain calls by passing the previous result as `hash`.
+inline uint64_t hashBytes(const void* data, size_t bytes, uint64_t hash = 14695981039346656037ull) {
+    const unsigned char* p = (const unsigned char*)data;
+    for (size_t i = 0; i < bytes; ++i) hash = (hash ^ p[i]) * 1099511628211ull;
+    return hash;
+}
+
+struct MeshCacheHeader {
+    char magic[4];          // "BZMC"
+    uint32_t version;
+    uint64_t key;
+    uint64_t vertexBytes;
+    uint64_t indexCount;
+};
+
+// Read-only mapping of one cache file; unmapped on destruction.
+class MappedMesh {
+public:
+    MappedMesh() = default;
+    ~MappedMesh() { close(); }
+    MappedMesh(const MappedMesh&) = delete;
+    MappedMesh& operator=(const MappedMesh&) = delete;
+
+    // False if the file is missing, truncated, or was written for another key or version.
+    bool open(const std::string& path, uint64_t key) {
+        close();
+        int fd = ::open(path.c_str(), O_RDONLY);
+        if (fd < 0) return false;
+        struct stat info;
+        if (fstat(fd, &info) == 0 && (size_t)info.st_size >= sizeof(MeshCacheHeader)) {
+            length = info.st_size;
+            base = mmap(NULL, length, PROT_READ, MAP_PRIVATE, fd, 0);
+        }
+        ::close(fd);
+        if (base == MAP_FAILED) { length = 0; return false; }
+
+        const MeshCacheHeader* header = (const MeshCacheHeader*)base;
+        bool valid = memcmp(header->magic, "BZMC", 4) == 0 && header->version == kVersion && header->key == key &&
+                     length == sizeof(MeshCacheHeader) + header->vertexBytes + header->indexCount * sizeof(uint32_t);
+        if (!valid) close();
+        return valid;
+    }
+
+    void close() {
+        if (base != MAP_FAILED) munmap(base, length);
+        base = MAP_FAILED;
+        length = 0;
+    }
+
+    const void* vertices() const { return (const char*)base + sizeof(MeshCacheHeader); }
+    size_t vertexBytes() const { return ((const MeshCacheHeader*)base)->vertexBytes; }
+    const uint32_t* indices() const { return (const uint32_t*)((const char*)vertices() + vertexBytes()); }
+    size_t indexCount() const { return ((const MeshCacheHeader*)base)->indexCount; }
+
+    static const uint32_t kVersion = 1;
+
+private:
+    void* base = MAP_FAILED;
+    size_t length = 0;
+};
+
+class MeshCache {
+public:
+    explicit MeshCache(const std::string& cacheDirectory) : directory(cacheDirectory) {}
+
+    std::string path(uint64_t key) const {
+        char name[32];
+        snprintf(name, sizeof(name), "mesh_%016llx.bin", (unsigned long long)key);
+        return directory + "/" + name;
+    }
+
+    bool load(uint64_t key, MappedMesh& mesh) const { return mesh.open(path(key), key); }
+
+    // Written under a temporary name and renamed, so a reader never maps a partial file.
+    bool store(uint64_t key, const void* vertices, size_t vertexBytes, const uint32_t* indices, size_t indexCount) const {
+        mkdir(directory.c_str(), 0755);
+        std::string target = path(key), temporary = target + ".tmp";
+        MeshCacheHeader header = { { 'B', 'Z', 'M', 'C' }, MappedMesh::kVersion, key, vertexBytes, indexCount };
+        {
+            std::ofstream file(temporary, std::ios::binary | std::ios::trunc);
+            if (!file) return false;
+            file.write((const char*)&header, sizeof(header));
+            file.write((const char*)vertices, vertexBytes);
+            if (indexCount) file.write((const char*)indices, indexCount * sizeof(uint32_t));
+            if (!file) { file.close(); remove(temporary.c_str()); return false; }
+        }
+        return rename(temporary.c_str(), target.c_str()) == 0;
+    }
+
+private:
+    std::string directory;
+};
@@ -0,0 +1,135 @@
+// Bounding volume hierarchy over axis-aligned object bounds, for CPU ray picking.
+//
+// build() splits the objects at the median centroid along the longest axis until at most
+// kLeafSize remain per leaf. Nodes live in one array, each left child right after its parent.
+// raycast() walks the tree front to back and passes each object whose box the ray enters
+// before the best hit so far to a caller-supplied exact test. Only the few objects along the
+// ray ever reach triangle level, whatever the scene size.
+#pragma once
+
+#include <glm/glm.hpp>
+
+#include <algorithm>
+#include <cfloat>
+#include <cstddef>
+#include <numeric>
+#include <vector>
+
+class ObjectBVH {
+public:
+    static const int kLeafSize = 4;
+
+    struct Stats {
+        int nodesVisited = 0, objectsTested = 0;
+    };
+
+    // One box per object; raycast() reports objects by their index here.
+    void build(const std::vector<glm::vec3>& lo, const std::vector<glm::vec3>& hi) {
+        boxLo = lo;
+        boxHi = hi;
+        order.resize(lo.size());
+        std::iota(order.begin(), order.end(), 0);
+        nodes.clear();
+        if (!order.empty()) buildNode(0, order.size());
+    }
+
+    size_t nodeCount() const { return nodes.size(); }
+
+    // exactHit(object, tMax, t) returns true and sets t < tMax when the ray origin + t * dir
+    // hits the object itself closer than tMax. Returns the closest object hit, or -1, and its
+    // ray parameter in tHit.
+    template <typename ExactHit>
+    int raycast(const glm::vec3& origin, const glm::vec3& dir, ExactHit exactHit, float& tHit, Stats* stats = NULL) const {
+        int best = -1;
+        float bestT = FLT_MAX;
+        if (!nodes.empty()) {
+            glm::vec3 invDir = 1.0f / dir;
+            int stack[64], top = 0;
+            float tEnter;
+            if (intersectBox(nodes[0], origin, invDir, bestT, tEnter)) stack[top++] = 0;
+            while (top > 0) {
+                int index = stack[--top];
+                const Node& node = nodes[index];
+                // The best hit may have moved in front of this node since it was pushed.
+                if (!intersectBox(node, origin, invDir, bestT, tEnter)) continue;
+                if (stats) ++stats->nodesVisited;
+                if (node.count > 0) {
+                    for (int i = node.first; i < node.first + node.count; ++i) {
+                        float t;
+                        if (stats) ++stats->objectsTested;
+                        if (exactHit(order[i], bestT, t) && t < bestT) { bestT = t; best = order[i]; }
+                    }
+                    continue;
+                }
+                // Push the farther child first so the nearer one is searched first.
+                int left = index + 1, right = node.first;
+                float tLeft, tRight;
+                bool hitLeft = intersectBox(nodes[left], origin, invDir, bestT, tLeft);
+                bool hitRight = intersectBox(nodes[right], origin, invDir, bestT, tRight);
+                if (hitLeft && hitRight) {
+                    stack[top++] = tLeft < tRight ? right : left;
+                    stack[top++] = tLeft < tRight ? left : right;
+                } else if (hitLeft) {
+                    stack[top++] = left;
+                } else if (hitRight) {
+                    stack[top++] = right;
+                }
+            }
+        }
+        tHit = bestT;
+        return best;
+    }
+
+private:
+    // Leaves hold order[first, first + count); interior nodes have count 0 and their right
+    // child at index first.
+    struct Node {
+        glm::vec3 lo, hi;
+        int first = 0, count = 0;
+    };
+
+    int buildNode(size_t begin, size_t end) {
+        int index = nodes.size();
+        nodes.push_back(Node());
+        glm::vec3 lo(FLT_MAX), hi(-FLT_MAX), centroidLo(FLT_MAX), centroidHi(-FLT_MAX);
+        for (size_t i = begin; i < end; ++i) {
+            int object = order[i];
+            lo = glm::min(lo, boxLo[object]);
+            hi = glm::max(hi, boxHi[object]);
+            glm::vec3 centroid = (boxLo[object] + boxHi[object]) * 0.5f;
+            centroidLo = glm::min(centroidLo, centroid);
+            centroidHi = glm::max(centroidHi, centroid);
+        }
+        nodes[index].lo = lo;
+        nodes[index].hi = hi;
+        if (end - begin <= (size_t)kLeafSize) {
+            nodes[index].first = begin;
+            nodes[index].count = end - begin;
+            return index;
+        }
+
+        glm::vec3 extent = centroidHi - centroidLo;
+        int axis = extent.x > extent.y ? (extent.x > extent.z ? 0 : 2) : (extent.y > extent.z ? 1 : 2);
+        size_t mid = (begin + end) / 2;
+        std::nth_element(order.begin() + begin, order.begin() + mid, order.begin() + end, [&](int a, int b) {
+            return boxLo[a][axis] + boxHi[a][axis] < boxLo[b][axis] + boxHi[b][axis];
+        });
+        buildNode(begin, mid);
+        int right = buildNode(mid, end);
+        nodes[index].first = right;
+        return index;
+    }
+
+    // Slab test, clipped to [0, tMax].
+    static bool intersectBox(const Node& node, const glm::vec3& origin, const glm::vec3& invDir, float tMax, float& tEnter) {
+        glm::vec3 t0 = (node.lo - origin) * invDir, t1 = (node.hi - origin) * invDir;
+        glm::vec3 tNear = glm::min(t0, t1), tFar = glm::max(t0, t1);
+        tEnter = std::max(std::max(tNear.x, tNear.y), std::max(tNear.z, 0.0f));
+        float tExit = std::min(std::min(tFar.x, tFar.y), std::min(tFar.z, tMax));
+        return tEnter <= tExit;
+    }
+
+    std::vector<glm::vec3> boxLo, boxHi;
+    std::vector<int> order;
+    std::vector<Node> nodes;
+};
@@ -0,0 +1,128 @@
+// Batched overlay for control points, axes and other debug geometry drawn over the scene.
+//
+// point(), line() and the helpers built on line() only append to CPU-side lists. flush()
+// streams everything into one StreamingBuffer slot and issues one draw for all points and one
+// for all lines, then empties the lists. Colour and point size travel with each vertex, so no
+// uniform or glPointSize changes are needed between primitives.
+//
+// The program passed to init() takes attributes aPos (vec3), aColor (vec3) and aSize (float,
+// written to gl_PointSize; needs GL_PROGRAM_POINT_SIZE) and uniforms view and projection.
+#pragma once
+
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+#include <glm/gtc/type_ptr.hpp>
+
+#include <cstddef>
+#include <cstring>
+#include <vector>
+
+#include "stream_buffer.h"
+
+class OverlayRenderer {
+public:
+    // Needs a current context.
+    void init(GLuint overlayProgram) {
+        program = overlayProgram;
+        positionLocation = glGetAttribLocation(program, "aPos");
+        colorLocation = glGetAttribLocation(program, "aColor");
+        sizeLocation = glGetAttribLocation(program, "aSize");
+        stream.init();
+        glGenVertexArrays(StreamingBuffer::kSlots, vaos);
+    }
+
+    void point(const glm::vec3& p, const glm::vec3& color, float size) {
+        points.push_back({ p, color, size });
+    }
+
+    void line(const glm::vec3& a, const glm::vec3& b, const glm::vec3& color) {
+        lines.push_back({ a, color, 1.0f });
+        lines.push_back({ b, color, 1.0f });
+    }
+
+    // Consecutive points joined by lines.
+    void polyline(const glm::vec3* p, int count, const glm::vec3& color, int stride = 1) {
+        for (int i = 0; i + 1 < count; ++i) line(p[i * stride], p[(i + 1) * stride], color);
+    }
+
+    // Axis-aligned box: the 4 edges parallel to each axis.
+    void box(const glm::vec3& lo, const glm::vec3& hi, const glm::vec3& color) {
+        for (int axis = 0; axis < 3; ++axis) {
+            int a = (axis + 1) % 3, b = (axis + 2) % 3;
+            for (int corner = 0; corner < 4; ++corner) {
+                glm::vec3 from = lo;
+                from[a] = corner & 1 ? hi[a] : lo[a];
+                from[b] = corner & 2 ? hi[b] : lo[b];
+                glm::vec3 to = from;
+                to[axis] = hi[axis];
+                line(from, to, color);
+            }
+        }
+    }
+
+    // Short red/green/blue lines along +X/+Y/+Z.
+    void axes(const glm::vec3& origin, float length) {
+        line(origin, origin + glm::vec3(length, 0.0f, 0.0f), glm::vec3(1.0f, 0.0f, 0.0f));
+        line(origin, origin + glm::vec3(0.0f, length, 0.0f), glm::vec3(0.0f, 1.0f, 0.0f));
+        line(origin, origin + glm::vec3(0.0f, 0.0f, length), glm::vec3(0.0f, 0.0f, 1.0f));
+    }
+
+    // Draws and clears everything queued since the last flush. Leaves the overlay program bound.
+    void flush(const glm::mat4& view, const glm::mat4& projection, float lineWidth = 1.0f) {
+        size_t count = points.size() + lines.size();
+        if (count == 0) return;
+        Vertex* out;
+        do {
+            out = (Vertex*)stream.beginWrite(count * sizeof(Vertex));
+            if (!out) break;
+            if (!points.empty()) memcpy(out, points.data(), points.size() * sizeof(Vertex));
+            if (!lines.empty()) memcpy(out + points.size(), lines.data(), lines.size() * sizeof(Vertex));
+        } while (!stream.endWrite());
+
+        if (out) {
+            glBindVertexArray(vaos[stream.slot()]);
+            if (stream.slotResized()) setVertexFormat();
+            glUseProgram(program);
+            glUniformMatrix4fv(glGetUniformLocation(program, "view"), 1, GL_FALSE, glm::value_ptr(view));
+            glUniformMatrix4fv(glGetUniformLocation(program, "projection"), 1, GL_FALSE, glm::value_ptr(projection));
+            if (!points.empty()) glDrawArrays(GL_POINTS, 0, points.size());
+            if (!lines.empty()) {
+                glLineWidth(lineWidth);
+                glDrawArrays(GL_LINES, points.size(), lines.size());
+            }
+            stream.fence();
+        }
+        points.clear();
+        lines.clear();
+    }
+
+private:
+    struct Vertex {
+        glm::vec3 position, color;
+        float size;
+    };
+
+    // For the slot just written; its VAO is bound.
+    void setVertexFormat() {
+        glBindBuffer(GL_ARRAY_BUFFER, stream.buffer());
+        GLsizei stride = sizeof(Vertex);
+        if (positionLocation >= 0) {
+            glVertexAttribPointer(positionLocation, 3, GL_FLOAT, GL_FALSE, stride, (void*)offsetof(Vertex, position));
+            glEnableVertexAttribArray(positionLocation);
+        }
+        if (colorLocation >= 0) {
+            glVertexAttribPointer(colorLocation, 3, GL_FLOAT, GL_FALSE, stride, (void*)offsetof(Vertex, color));
+            glEnableVertexAttribArray(colorLocation);
+        }
+        if (sizeLocation >= 0) {
+            glVertexAttribPointer(sizeLocation, 1, GL_FLOAT, GL_FALSE, stride, (void*)offsetof(Vertex, size));
+            glEnableVertexAttribArray(sizeLocation);
+        }
+    }
+
+    GLuint program = 0;
+    GLint positionLocation = -1, colorLocation = -1, sizeLocation = -1;
+    StreamingBuffer stream;
+    GLuint vaos[StreamingBuffer::kSlots] = {};
+    std::vector<Vertex> points, lines;
+};
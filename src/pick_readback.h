@@ -0,0 +1,123 @@
+// Non-blocking readback of picking-buffer texels: one under a click, or a marquee rectangle.
+//
+// request() and requestRegion() issue glReadPixels into a pixel buffer object, which only
+// queues the copy, and fence it. poll(), called once a frame, checks the oldest fence without
+// waiting; once it has signalled, the PBO is mapped and the request's callback runs. Results
+// arrive one or two frames after the click, and a click never stalls the pipeline the way a
+// glReadPixels into client memory does.
+//
+// Without ARB_sync (GL < 3.2) a request is resolved kFallbackFrames polls later instead; by
+// then the copy has almost always finished, so the fetch rarely waits.
+#pragma once
+
+#include <glad/glad.h>
+
+#include <functional>
+#include <utility>
+
+class AsyncPickReadback {
+public:
+    typedef std::function<void(GLuint objectID)> Callback;
+    // ids is row-major, bottom row first, and only valid during the call.
+    typedef std::function<void(const GLuint* ids, int width, int height)> RegionCallback;
+    static const int kSlots = 4;
+    static const int kFallbackFrames = 2;
+
+    // Needs a current context.
+    void init() {
+        glGenBuffers(kSlots, pbos);
+        for (GLuint pbo : pbos) {
+            glBindBuffer(GL_PIXEL_PACK_BUFFER, pbo);
+            glBufferData(GL_PIXEL_PACK_BUFFER, sizeof(GLuint), NULL, GL_STREAM_READ);
+        }
+        for (size_t& bytes : capacity) bytes = sizeof(GLuint);
+        glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+        haveSync = glFenceSync && glClientWaitSync && glDeleteSync;
+    }
+
+    bool usesFences() const { return haveSync; }
+
+    // Queues a copy of texel (x, y) of the bound read framebuffer's GL_R32UI colour buffer.
+    // Returns false, dropping the request, when every slot is still in flight.
+    bool request(int x, int y, Callback callback) {
+        return requestRegion(x, y, 1, 1, [callback](const GLuint* ids, int, int) { callback(ids[0]); });
+    }
+
+    // The same for a width x height rectangle with its lower-left texel at (x, y). A slot's
+    // PBO grows to the largest region it has been asked for.
+    bool requestRegion(int x, int y, int width, int height, RegionCallback callback) {
+        int slot = -1;
+        for (int i = 0; i < kSlots && slot < 0; ++i) {
+            if (!slots[i].busy) slot = i;
+        }
+        if (slot < 0) return false;
+
+        size_t bytes = (size_t)width * height * sizeof(GLuint);
+        glBindBuffer(GL_PIXEL_PACK_BUFFER, pbos[slot]);
+        if (bytes > capacity[slot]) {
+            glBufferData(GL_PIXEL_PACK_BUFFER, bytes, NULL, GL_STREAM_READ);
+            capacity[slot] = bytes;
+        }
+        glReadPixels(x, y, width, height, GL_RED_INTEGER, GL_UNSIGNED_INT, (void*)0);
+        glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+
+        Slot& s = slots[slot];
+        s.busy = true;
+        s.width = width;
+        s.height = height;
+        s.sequence = nextSequence++;
+        s.framesLeft = kFallbackFrames;
+        s.fence = haveSync ? glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0) : 0;
+        s.callback = std::move(callback);
+        return true;
+    }
+
+    // Delivers finished requests oldest first. The GPU completes them in order, so the first
+    // one still running ends the scan.
+    void poll() {
+        for (;;) {
+            int oldest = -1;
+            for (int i = 0; i < kSlots; ++i) {
+                if (slots[i].busy && (oldest < 0 || slots[i].sequence < slots[oldest].sequence)) oldest = i;
+            }
+            if (oldest < 0) return;
+
+            Slot& s = slots[oldest];
+            if (s.fence) {
+                if (glClientWaitSync(s.fence, GL_SYNC_FLUSH_COMMANDS_BIT, 0) == GL_TIMEOUT_EXPIRED) return;
+                glDeleteSync(s.fence);
+                s.fence = 0;
+            } else if (--s.framesLeft > 0) {
+                return;
+            }
+
+            // The slot stays busy while mapped, so a request made from the callback uses another.
+            size_t bytes = (size_t)s.width * s.height * sizeof(GLuint);
+            glBindBuffer(GL_PIXEL_PACK_BUFFER, pbos[oldest]);
+            const GLuint* ids = (const GLuint*)glMapBufferRange(GL_PIXEL_PACK_BUFFER, 0, bytes, GL_MAP_READ_BIT);
+            glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+            RegionCallback callback = std::move(s.callback);
+            if (ids) callback(ids, s.width, s.height);
+            glBindBuffer(GL_PIXEL_PACK_BUFFER, pbos[oldest]);
+            if (ids) glUnmapBuffer(GL_PIXEL_PACK_BUFFER);
+            glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+            s.busy = false;
+        }
+    }
+
+private:
+    struct Slot {
+        bool busy = false;
+        unsigned sequence = 0;
+        int framesLeft = 0;
+        int width = 0, height = 0;
+        GLsync fence = 0;
+        RegionCallback callback;
+    };
+
+    GLuint pbos[kSlots] = {};
+    size_t capacity[kSlots] = {};
+    Slot slots[kSlots];
+    unsigned nextSequence = 0;
+    bool haveSync = false;
+};
@@ -0,0 +1,122 @@
+// Ring of vertex buffers for geometry that is rebuilt on the CPU and then drawn until the
+// next rebuild.
+//
+// beginWrite(bytes) returns GPU-visible memory in the next slot of the ring. The caller fills
+// it (from any thread, as long as endWrite() runs on the GL thread afterwards) and then draws
+// from buffer(). After the draws that read a slot, fence() marks it; beginWrite() waits on that
+// fence before handing the slot out again, so the CPU never overwrites data still in flight.
+//
+// The strategy is picked once in init():
+//   Persistent     - GL 4.4 / ARB_buffer_storage: each slot stays mapped (coherent) for its lifetime.
+//   Unsynchronized - glMapBufferRange(GL_MAP_UNSYNCHRONIZED_BIT) per write, ordered by the fences.
+//   Orphan         - no ARB_sync: glBufferData(NULL) orphans the old store before an invalidating map.
+#pragma once
+
+#include <glad/glad.h>
+#include <GLFW/glfw3.h>
+
+#include <cstddef>
+
+// glad is generated for GL 3.3, so the buffer-storage entry point is loaded by hand.
+#ifndef GL_MAP_PERSISTENT_BIT
+#define GL_MAP_PERSISTENT_BIT 0x0040
+#endif
+#ifndef GL_MAP_COHERENT_BIT
+#define GL_MAP_COHERENT_BIT 0x0080
+#endif
+
+class StreamingBuffer {
+public:
+    enum Mode { Orphan, Unsynchronized, Persistent };
+    static const int kSlots = 3;
+
+    // Needs a current context.
+    void init() {
+        glGenBuffers(kSlots, names);
+        bool haveSync = glFenceSync && glClientWaitSync && glDeleteSync;
+        bool haveStorage = GLVersion.major > 4 || (GLVersion.major == 4 && GLVersion.minor >= 4) ||
+                           glfwExtensionSupported("GL_ARB_buffer_storage");
+        if (haveSync && haveStorage) bufferStorage = (BufferStorageProc)glfwGetProcAddress("glBufferStorage");
+        mode = bufferStorage ? Persistent : haveSync ? Unsynchronized : Orphan;
+    }
+
+    // Returns `bytes` of writable memory in the next slot, or NULL if the map failed. Leaves
+    // that slot bound to GL_ARRAY_BUFFER.
+    void* beginWrite(size_t bytes) {
+        current = (current + 1) % kSlots;
+        waitForSlot(current);
+        resized = bytes > capacity[current];
+        if (resized) allocate(bytes);
+        else glBindBuffer(GL_ARRAY_BUFFER, names[current]);
+
+        if (mode == Persistent) return mapped[current];
+        GLbitfield access = GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_RANGE_BIT | GL_MAP_UNSYNCHRONIZED_BIT;
+        if (mode == Orphan) {
+            glBufferData(GL_ARRAY_BUFFER, capacity[current], NULL, GL_STREAM_DRAW);
+            access = GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_BUFFER_BIT;
+        }
+        return glMapBufferRange(GL_ARRAY_BUFFER, 0, bytes, access);
+    }
+
+    // False if the driver lost the mapped contents and the slot has to be written again.
+    bool endWrite() {
+        if (mode == Persistent) return true;
+        glBindBuffer(GL_ARRAY_BUFFER, names[current]);
+        return glUnmapBuffer(GL_ARRAY_BUFFER) == GL_TRUE;
+    }
+
+    // Call after the draws that read buffer(); replaces the slot's previous fence.
+    void fence() {
+        if (mode == Orphan) return;
+        if (fences[current]) glDeleteSync(fences[current]);
+        fences[current] = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+    }
+
+    GLuint buffer() const { return names[current]; }
+    int slot() const { return current; }
+    // True when the last beginWrite() (re)created the slot's storage. Persistent slots get a
+    // new buffer name then, so vertex attribute pointers into it must be specified again.
+    bool slotResized() const { return resized; }
+
+    const char* modeName() const {
+        return mode == Persistent ? "persistent-mapped" : mode == Unsynchronized ? "unsynchronized map" : "orphaning";
+    }
+
+private:
+    typedef void (APIENTRYP BufferStorageProc)(GLenum target, GLsizeiptr size, const void* data, GLbitfield flags);
+
+    void waitForSlot(int s) {
+        if (!fences[s]) return;
+        while (glClientWaitSync(fences[s], GL_SYNC_FLUSH_COMMANDS_BIT, 1000000) == GL_TIMEOUT_EXPIRED) {}
+        glDeleteSync(fences[s]);
+        fences[s] = 0;
+    }
+
+    void allocate(size_t bytes) {
+        bool hadStorage = capacity[current] != 0;
+        capacity[current] = bytes;
+        if (mode != Persistent) {
+            glBindBuffer(GL_ARRAY_BUFFER, names[current]);
+            glBufferData(GL_ARRAY_BUFFER, bytes, NULL, GL_STREAM_DRAW);
+            return;
+        }
+        // Immutable storage cannot grow; replace the buffer object instead.
+        if (hadStorage) {
+            glDeleteBuffers(1, &names[current]);
+            glGenBuffers(1, &names[current]);
+        }
+        GLbitfield flags = GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+        glBindBuffer(GL_ARRAY_BUFFER, names[current]);
+        bufferStorage(GL_ARRAY_BUFFER, bytes, NULL, flags);
+        mapped[current] = glMapBufferRange(GL_ARRAY_BUFFER, 0, bytes, flags);
+    }
+
+    Mode mode = Orphan;
+    BufferStorageProc bufferStorage = NULL;
+    GLuint names[kSlots] = {};
+    GLsync fences[kSlots] = {};
+    size_t capacity[kSlots] = {};
+    void* mapped[kSlots] = {};
+    int current = kSlots - 1;
+    bool resized = false;
+};
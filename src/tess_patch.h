@@ -0,0 +1,97 @@
+// Hardware tessellation of bicubic Bezier patches (GL 4.0 / ARB_tessellation_shader).
+//
+// Each patch is submitted as one 16-vertex GL_PATCHES primitive that indexes into a shared
+// control-point buffer, so welded points are stored once. bezier_patch.tesc picks the
+// tessellation levels from the projected length of each boundary; bezier_patch.tese evaluates
+// position, normal and (u,v) on the GPU. An edit is a glBufferSubData of the control points.
+//
+// glad is generated for GL 3.3, so glPatchParameteri and the tessellation enums are provided
+// here. Without support, init() returns false and the demo keeps its CPU tessellation path.
+#pragma once
+
+#include <glad/glad.h>
+#include <GLFW/glfw3.h>
+#include <glm/glm.hpp>
+
+#include <cstddef>
+
+#ifndef GL_PATCHES
+#define GL_PATCHES 0x000E
+#endif
+#ifndef GL_PATCH_VERTICES
+#define GL_PATCH_VERTICES 0x8E72
+#endif
+#ifndef GL_TESS_CONTROL_SHADER
+#define GL_TESS_CONTROL_SHADER 0x8E88
+#endif
+#ifndef GL_TESS_EVALUATION_SHADER
+#define GL_TESS_EVALUATION_SHADER 0x8E87
+#endif
+#ifndef GL_MAX_TESS_GEN_LEVEL
+#define GL_MAX_TESS_GEN_LEVEL 0x8E7E
+#endif
+
+class TessellatedPatches {
+public:
+    // Needs a current context.
+    bool init() {
+        bool supported = GLVersion.major >= 4 || glfwExtensionSupported("GL_ARB_tessellation_shader");
+        if (supported) patchParameteri = (PatchParameteriProc)glfwGetProcAddress("glPatchParameteri");
+        if (!patchParameteri) return false;
+        GLint maxLevel = 64;
+        glGetIntegerv(GL_MAX_TESS_GEN_LEVEL, &maxLevel);
+        maxTessLevel = (float)maxLevel;
+        glGenVertexArrays(1, &vao);
+        glGenBuffers(1, &vbo);
+        glGenBuffers(1, &ebo);
+        return true;
+    }
+
+    bool available() const { return patchParameteri != NULL; }
+    float maxLevel() const { return maxTessLevel; }
+
+    // Location of the program's vec3 control-point attribute.
+    void setPositionAttribute(GLint location) {
+        glBindVertexArray(vao);
+        glBindBuffer(GL_ARRAY_BUFFER, vbo);
+        glVertexAttribPointer(location, 3, GL_FLOAT, GL_FALSE, sizeof(glm::vec3), (void*)0);
+        glEnableVertexAttribArray(location);
+    }
+
+    // 16 row-major indices into the control points per patch.
+    void setPatches(const int* indices, size_t patchCount) {
+        count = patchCount * 16;
+        glBindVertexArray(vao);
+        glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, ebo);
+        glBufferData(GL_ELEMENT_ARRAY_BUFFER, count * sizeof(GLuint), indices, GL_STATIC_DRAW);
+    }
+
+    // The whole cost of an edit. Reallocates only when the point count changes.
+    void setControlPoints(const glm::vec3* points, size_t pointCount) {
+        glBindBuffer(GL_ARRAY_BUFFER, vbo);
+        if (pointCount != capacity) {
+            glBufferData(GL_ARRAY_BUFFER, pointCount * sizeof(glm::vec3), points, GL_DYNAMIC_DRAW);
+            capacity = pointCount;
+        } else {
+            glBufferSubData(GL_ARRAY_BUFFER, 0, pointCount * sizeof(glm::vec3), points);
+        }
+    }
+
+    // Sets the level uniforms of `program` (built with bezier_patch.tesc, and bound) and draws.
+    void draw(GLuint program, const glm::vec2& viewportSize, float pixelsPerSegment) {
+        glUniform2f(glGetUniformLocation(program, "viewportSize"), viewportSize.x, viewportSize.y);
+        glUniform1f(glGetUniformLocation(program, "pixelsPerSegment"), pixelsPerSegment);
+        glUniform1f(glGetUniformLocation(program, "maxTessLevel"), maxTessLevel);
+        glBindVertexArray(vao);
+        patchParameteri(GL_PATCH_VERTICES, 16);
+        glDrawElements(GL_PATCHES, count, GL_UNSIGNED_INT, 0);
+    }
+
+private:
+    typedef void (APIENTRYP PatchParameteriProc)(GLenum pname, GLint value);
+
+    PatchParameteriProc patchParameteri = NULL;
+    GLuint vao = 0, vbo = 0, ebo = 0;
+    size_t count = 0, capacity = 0;
+    float maxTessLevel = 64.0f;
+};
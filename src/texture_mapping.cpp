@@ -12,6 +12,16 @@
 #include <fstream>
 #include <sstream>
 #include <cmath>
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+
+#include "bezier_simd.h"
+#include "thread_pool.h"
+#include "stream_buffer.h"
+#include "mesh_cache.h"
+#include "tess_patch.h"
 
 using namespace std;
 using namespace glm;
@@ -21,17 +31,100 @@ void framebuffer_size_callback(GLFWwindow* window, int width, int height);
 string loadShaderFromFile(const string& filePath);
 GLuint compileShader(GLenum type, const char* src);
 GLuint makeProgram(const string& vertexPath, const string& fragmentPath);
-void updatePatchGeometry();
-vec3 evaluateBezierCurve(const vec3& p0, const vec3& p1, const vec3& p2, const vec3& p3, float t);
-vec3 evaluateBezierPatch(float u, float v);
+GLuint makeTessellationProgram(const string& vertexPath, const string& controlPath, const string& evaluationPath, const string& fragmentPath);
+void updatePatchGeometry(bool useCache = false);
+void tessellatePatch(void* vertices, bool buildIndices);
+uint64_t patchCacheKey();
+void buildFlatTriangleRows(void* out, int rowBegin, int rowEnd);
+struct PackedVertex;
+void updatePatchBounds();
+void packPatchVertex(const float* v, PackedVertex& out);
+uint32_t packNormal(const vec3& n);
+void setPatchVertexFormat(bool packed);
+size_t patchVertexSize();
+void buildGridIndexRows(int rowBegin, int rowEnd);
+void buildGridStripRows(int rowBegin, int rowEnd);
+size_t patchIndexCount(int n);
+void benchmarkPatchTopologies();
+vec3 setCameraUniforms(GLuint shader);
+void setStreamedMeshUniforms();
+struct LodMesh;
+float lodLevelForView(const vec3& camPos);
+LodMesh& acquireLodMesh(int level);
+void buildLodMesh(LodMesh& mesh, int level);
 
 // --- Globals ---
 int windowWidth = 800, windowHeight = 600;
-GLuint patchShader;
-vector<float> patchVertices;
-GLuint patchVAO = 0, patchVBO = 0;
+GLuint patchShader, tessPatchShader = 0;
+vector<float> patchGrid;
+vector<GLuint> patchIndices;
+BezierPatchTessellator patchTessellator;
+ThreadPool tessellationPool;
+// Vertices are tessellated straight into a ring of mapped buffers; each slot has its own VAO,
+// so attribute pointers are only specified when a slot's storage is (re)created.
+StreamingBuffer patchStream;
+GLuint patchVAOs[StreamingBuffer::kSlots] = {}, patchEBO = 0;
+size_t patchVertexCount = 0;
+int patchIndexLevel = 0; // level the index buffer was built for
+// The startup mesh is also stored in cache/, keyed by everything it depends on, so a relaunch
+// maps the file and uploads it instead of tessellating. Only the startup configuration is
+// cached, which keeps cache/ to one file per set of inputs and every later rebuild on the
+// direct path. TESS_CACHE=0 turns the cache off.
+MeshCache patchCache("cache");
+bool usePatchCache = true;
+bool patchCacheHit = false; // the startup mesh was served from the cache
+// The indexed grid is drawn as a triangle list or as one triangle strip per quad row. Strips
+// are split by primitive restart (GL 3.1) or, on a plain 3.0 context, by two degenerate
+// triangles; every row has the same index count either way, so bands can fill rows in place.
+enum PatchTopology { TriangleList, TriangleStrips };
+PatchTopology patchTopology = TriangleList; // T
+PatchTopology patchIndexTopology = TriangleList; // topology the index buffer was built for
+bool usePrimitiveRestart = false;
+const GLuint patchRestartIndex = 0xFFFFFFFFu;
 float camAngle = 45.0f, camPitch = 30.0f, camDist = 8.0f;
 int tessellationLevel = 150;
+bool useIndexedPatch = false; // N: shared-vertex grid with analytic normals
+bool nKeyWasPressed = false, plusKeyWasPressed = false, minusKeyWasPressed = false, lKeyWasPressed = false, pKeyWasPressed = false;
+bool tKeyWasPressed = false, bKeyWasPressed = false, hKeyWasPressed = false;
+// H: the patch as one GL_PATCHES primitive through bezier_patch.tesc/.tese, about
+// lodPixelsPerSegment pixels per segment. Off at startup; available where GL 4.0 tessellation
+// exists. N/P/T/+/- keep rebuilding the CPU mesh while it is on, so switching back shows them.
+bool useHardwareTessellation = false;
+TessellatedPatches hardwarePatches;
+
+// --- Packed Vertex Format ---
+// 16 bytes instead of 32: positions as 16-bit unorm within the control points' bounding box
+// (the patch never leaves its convex hull), normals as 10:10:10:2 signed, uv as 16-bit unorm.
+// The vertex shader maps positions back with positionOffset + positionScale * aPos. Without
+// GL 3.3 / ARB_vertex_type_2_10_10_10_rev the normal word holds four signed bytes instead.
+struct PackedVertex {
+    uint16_t position[3], pad;
+    uint32_t normal;
+    uint16_t texCoords[2];
+};
+bool usePackedVertices = false; // P
+bool packedNormals1010102 = false;
+bool patchSlotPacked[StreamingBuffer::kSlots] = {}; // format each slot's VAO is set up for
+vec3 patchBoundsMin(0.0f), patchBoundsScale(1.0f);
+
+// --- Distance-Driven LOD ---
+// With L on, the level follows the projected size of the patch instead of tessellationLevel.
+// Meshes exist at power-of-two levels only and are kept in a small LRU cache. Each one also
+// stores every vertex's position on the half-resolution mesh, and the vertex shader blends
+// towards it, so the mesh at level 2L with morph 0 is exactly the mesh at level L.
+struct LodMesh {
+    int level = 0;
+    GLuint vao = 0, vbo = 0, ebo = 0;
+    GLsizei indexCount = 0;
+    unsigned lastUsed = 0;
+};
+bool useLod = false; // L
+const int lodCacheSize = 4, lodMinLevel = 8, lodMaxLevel = 1024;
+const float lodPixelsPerSegment = 8.0f;
+LodMesh lodCache[lodCacheSize];
+BezierPatchTessellator lodTessellator;
+unsigned lodFrame = 0;
+int lodShownLevel = 0;
 
 vector<vec3> controlPoints = {
     vec3(-1.5, -1.5, -1.0), vec3(-0.5, -1.5, -1.0), vec3(0.5, -1.5, -1.0), vec3(1.5, -1.5, -1.0),
@@ -53,14 +146,45 @@ int main() {
     if (!gladLoadGLLoader((GLADloadproc)glfwGetProcAddress)) { cout << "Failed to initialize GLAD" << endl; return -1; }
 
     glEnable(GL_DEPTH_TEST);
+    packedNormals1010102 = GLVersion.major > 3 || (GLVersion.major == 3 && GLVersion.minor >= 3) ||
+                           glfwExtensionSupported("GL_ARB_vertex_type_2_10_10_10_rev");
+    usePrimitiveRestart = GLVersion.major > 3 || (GLVersion.major == 3 && GLVersion.minor >= 1);
+    if (usePrimitiveRestart) {
+        glEnable(GL_PRIMITIVE_RESTART);
+        glPrimitiveRestartIndex(patchRestartIndex);
+    }
 
     patchShader = makeProgram("shaders/procedural_patch.vert", "shaders/procedural_patch.frag");
+    if (hardwarePatches.init()) {
+        tessPatchShader = makeTessellationProgram("shaders/bezier_patch_tess.vert", "shaders/bezier_patch.tesc",
+                                                  "shaders/bezier_patch.tese", "shaders/procedural_patch.frag");
+        int indices[16];
+        for (int k = 0; k < 16; ++k) indices[k] = k;
+        hardwarePatches.setPositionAttribute(0);
+        hardwarePatches.setPatches(indices, 1);
+        hardwarePatches.setControlPoints(controlPoints.data(), controlPoints.size());
+    }
     
-    glGenVertexArrays(1, &patchVAO);
-    glGenBuffers(1, &patchVBO);
-    updatePatchGeometry();
+    const char* cacheSetting = getenv("TESS_CACHE");
+    usePatchCache = !cacheSetting || strcmp(cacheSetting, "0") != 0;
+    patchStream.init();
+    glGenVertexArrays(StreamingBuffer::kSlots, patchVAOs);
+    glGenBuffers(1, &patchEBO);
+    for (GLuint vao : patchVAOs) {
+        glBindVertexArray(vao);
+        glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, patchEBO);
+    }
+    double firstMeshStart = glfwGetTime();
+    updatePatchGeometry(usePatchCache);
+    double firstMeshMs = (glfwGetTime() - firstMeshStart) * 1000.0;
 
-    cout << "--- Bezier Patch with Procedural Rings Texture ---\n" << "Controls: W/S/A/D to orbit camera, Z/X to zoom.\n";
+    cout << "--- Bezier Patch with Procedural Rings Texture ---\n" << "Controls: W/S/A/D to orbit camera, Z/X to zoom, N to toggle indexed/smooth mesh, +/- to change tessellation level, L to toggle distance-driven LOD, P to toggle packed vertices, T to toggle triangle list/strips, B to benchmark both, H to toggle hardware tessellation.\n"
+         << "Tessellator: Bernstein tables, " << kSimdName << " row kernels, " << tessellationPool.size() << " threads\n"
+         << "Vertex streaming: " << patchStream.modeName() << " ring of " << StreamingBuffer::kSlots << " buffers\n"
+         << "Strip joins: " << (usePrimitiveRestart ? "primitive restart" : "degenerate triangles") << "\n"
+         << "Hardware tessellation (H): " << (tessPatchShader ? "available" : "unavailable (no GL 4.0 tessellation support)") << "\n"
+         << "First mesh (level " << tessellationLevel << "): " << firstMeshMs << " ms, "
+         << (!usePatchCache ? "cache off" : patchCacheHit ? "mapped from the tessellation cache" : "tessellated and cached") << "\n";
 
     while (!glfwWindowShouldClose(window)) {
         // --- Input (Camera Control) ---
@@ -71,28 +195,96 @@ int main() {
         if (glfwGetKey(window, GLFW_KEY_Z) == GLFW_PRESS) camDist = glm::max(0.5f, camDist - 0.2f);
         if (glfwGetKey(window, GLFW_KEY_X) == GLFW_PRESS) camDist += 0.2f;
         if (glfwGetKey(window, GLFW_KEY_ESCAPE) == GLFW_PRESS) glfwSetWindowShouldClose(window, true);
+        bool nKeyPressed = glfwGetKey(window, GLFW_KEY_N) == GLFW_PRESS;
+        if (nKeyPressed && !nKeyWasPressed) {
+            useIndexedPatch = !useIndexedPatch;
+            updatePatchGeometry();
+            cout << "Patch mesh: " << (useIndexedPatch ? "Indexed grid, " : "Triangle list, ")
+                 << patchVertexCount << " vertices, " << patchVertexCount * patchVertexSize() / 1024 << " KB" << endl;
+        }
+        nKeyWasPressed = nKeyPressed;
+        bool pKeyPressed = glfwGetKey(window, GLFW_KEY_P) == GLFW_PRESS;
+        if (pKeyPressed && !pKeyWasPressed) {
+            usePackedVertices = !usePackedVertices;
+            updatePatchGeometry();
+            cout << "Patch vertices: " << (usePackedVertices ? "packed (" : "float (") << patchVertexSize() << " bytes), "
+                 << patchVertexCount * patchVertexSize() / 1024 << " KB" << endl;
+        }
+        pKeyWasPressed = pKeyPressed;
+        bool tKeyPressed = glfwGetKey(window, GLFW_KEY_T) == GLFW_PRESS;
+        if (tKeyPressed && !tKeyWasPressed) {
+            patchTopology = patchTopology == TriangleList ? TriangleStrips : TriangleList;
+            updatePatchGeometry();
+            cout << "Indexed grid topology: " << (patchTopology == TriangleList ? "triangle list, " : "triangle strips, ")
+                 << patchIndexCount(tessellationLevel) << " indices" << (useIndexedPatch ? "" : " (press N to draw the indexed grid)") << endl;
+        }
+        tKeyWasPressed = tKeyPressed;
+        bool bKeyPressed = glfwGetKey(window, GLFW_KEY_B) == GLFW_PRESS;
+        if (bKeyPressed && !bKeyWasPressed) benchmarkPatchTopologies();
+        bKeyWasPressed = bKeyPressed;
+        bool lKeyPressed = glfwGetKey(window, GLFW_KEY_L) == GLFW_PRESS;
+        if (lKeyPressed && !lKeyWasPressed) {
+            useLod = !useLod;
+            lodShownLevel = 0;
+            cout << "Distance-driven LOD: " << (useLod ? "ON" : "OFF") << endl;
+        }
+        lKeyWasPressed = lKeyPressed;
+        bool hKeyPressed = glfwGetKey(window, GLFW_KEY_H) == GLFW_PRESS;
+        if (hKeyPressed && !hKeyWasPressed) {
+            if (!tessPatchShader) {
+                cout << "Hardware tessellation needs GL 4.0 or ARB_tessellation_shader" << endl;
+            } else {
+                useHardwareTessellation = !useHardwareTessellation;
+                cout << "Patch path: " << (useHardwareTessellation ? "hardware tessellation shaders" : "CPU tessellation") << endl;
+            }
+        }
+        hKeyWasPressed = hKeyPressed;
+        bool plusKeyPressed = glfwGetKey(window, GLFW_KEY_EQUAL) == GLFW_PRESS;
+        bool minusKeyPressed = glfwGetKey(window, GLFW_KEY_MINUS) == GLFW_PRESS;
+        if ((plusKeyPressed && !plusKeyWasPressed) || (minusKeyPressed && !minusKeyWasPressed)) {
+            tessellationLevel = plusKeyPressed ? glm::min(1000, tessellationLevel * 2) : glm::max(10, tessellationLevel / 2);
+            double start = glfwGetTime();
+            updatePatchGeometry();
+            cout << "Tessellation level " << tessellationLevel << ": " << (glfwGetTime() - start) * 1000.0 << " ms on "
+                 << tessellationPool.size() << " threads" << endl;
+        }
+        plusKeyWasPressed = plusKeyPressed;
+        minusKeyWasPressed = minusKeyPressed;
 
         // --- Rendering ---
         glClearColor(0.1f, 0.1f, 0.15f, 1.0f);
         glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
 
-        float camX = camDist * cos(radians(camAngle)) * cos(radians(camPitch));
-        float camY = camDist * sin(radians(camPitch));
-        float camZ = camDist * sin(radians(camAngle)) * cos(radians(camPitch));
-        vec3 camPos = vec3(camX, camY, camZ);
-        mat4 view = lookAt(camPos, vec3(0.0), vec3(0.0, 1.0, 0.0));
-        mat4 projection = perspective(radians(45.0f), (float)windowWidth / (float)windowHeight, 0.1f, 100.0f);
-        
-        glUseProgram(patchShader);
-        glUniformMatrix4fv(glGetUniformLocation(patchShader, "model"), 1, GL_FALSE, value_ptr(mat4(1.0f)));
-        glUniformMatrix4fv(glGetUniformLocation(patchShader, "view"), 1, GL_FALSE, value_ptr(view));
-        glUniformMatrix4fv(glGetUniformLocation(patchShader, "projection"), 1, GL_FALSE, value_ptr(projection));
-        glUniform3fv(glGetUniformLocation(patchShader, "viewPos"), 1, value_ptr(camPos));
-        glUniform3f(glGetUniformLocation(patchShader, "lightPos"), 0.0f, 2.0f, 5.0f);
-        glUniform1f(glGetUniformLocation(patchShader, "shininess"), 256.0f);
+        GLuint shader = useHardwareTessellation ? tessPatchShader : patchShader;
+        glUseProgram(shader);
+        vec3 camPos = setCameraUniforms(shader);
 
-        glBindVertexArray(patchVAO);
-        glDrawArrays(GL_TRIANGLES, 0, tessellationLevel * tessellationLevel * 6);
+        if (useHardwareTessellation) {
+            hardwarePatches.draw(shader, vec2(windowWidth, windowHeight), lodPixelsPerSegment);
+        } else if (useLod) {
+            // A level L in [2^k, 2^(k+1)) draws the 2^(k+1) mesh, morphed L / 2^k - 1 of the way
+            // from its 2^k parent, so crossing a power of two swaps between identical shapes.
+            float level = lodLevelForView(camPos);
+            int coarse = glm::min(1 << (int)floor(log2(level)), lodMaxLevel / 2);
+            float morph = glm::min(level / coarse - 1.0f, 1.0f);
+            LodMesh& mesh = acquireLodMesh(coarse * 2);
+            if (mesh.level != lodShownLevel) {
+                lodShownLevel = mesh.level;
+                cout << "LOD level " << mesh.level << " (morphing from " << coarse << "), "
+                     << (mesh.level + 1) * (mesh.level + 1) << " vertices" << endl;
+            }
+            glUniform1f(glGetUniformLocation(patchShader, "morph"), morph);
+            glUniform3f(glGetUniformLocation(patchShader, "positionOffset"), 0.0f, 0.0f, 0.0f);
+            glUniform3f(glGetUniformLocation(patchShader, "positionScale"), 1.0f, 1.0f, 1.0f);
+            glBindVertexArray(mesh.vao);
+            glDrawElements(GL_TRIANGLES, mesh.indexCount, GL_UNSIGNED_INT, 0);
+        } else {
+            setStreamedMeshUniforms();
+            glBindVertexArray(patchVAOs[patchStream.slot()]);
+            if (useIndexedPatch) glDrawElements(patchTopology == TriangleList ? GL_TRIANGLES : GL_TRIANGLE_STRIP, patchIndices.size(), GL_UNSIGNED_INT, 0);
+            else glDrawArrays(GL_TRIANGLES, 0, tessellationLevel * tessellationLevel * 6);
+            patchStream.fence();
+        }
 
         // --- REMOVED: All code for drawing control points and axes is gone ---
 
@@ -103,47 +295,410 @@ int main() {
     return 0;
 }
 
-void updatePatchGeometry() {
-    patchVertices.clear();
-    float step = 1.0f / (float)tessellationLevel;
-    for (int i = 0; i < tessellationLevel; ++i) {
-        for (int j = 0; j < tessellationLevel; ++j) {
-            float u0 = (float)i * step, v0 = (float)j * step;
-            float u1 = (float)(i + 1) * step, v1 = (float)(j + 1) * step;
-            vec3 p00 = evaluateBezierPatch(u0, v0); vec3 p10 = evaluateBezierPatch(u1, v0);
-            vec3 p01 = evaluateBezierPatch(u0, v1); vec3 p11 = evaluateBezierPatch(u1, v1);
+void updatePatchGeometry(bool useCache) {
+    int n = tessellationLevel;
+    if (usePackedVertices) updatePatchBounds();
+    patchVertexCount = useIndexedPatch ? (size_t)(n + 1) * (n + 1) : (size_t)n * n * 6;
+    size_t bytes = patchVertexCount * patchVertexSize();
+    size_t indexCount = useIndexedPatch ? patchIndexCount(n) : 0;
+    bool buildIndices = useIndexedPatch && (patchIndexLevel != n || patchIndexTopology != patchTopology);
+
+    // Normally the mesh is tessellated straight into the mapped slot. With useCache, a hit is
+    // one memcpy from the mapped file; a miss is built in system memory first, since the
+    // write-only mapping can't be read back to store it.
+    MappedMesh cached;
+    vector<unsigned char> built;
+    uint64_t key = useCache ? patchCacheKey() : 0;
+    patchCacheHit = useCache && patchCache.load(key, cached) &&
+                    cached.vertexBytes() == bytes && cached.indexCount() == indexCount;
+    if (patchCacheHit) {
+        if (buildIndices) patchIndices.assign(cached.indices(), cached.indices() + indexCount);
+    } else if (useCache) {
+        built.resize(bytes);
+        tessellatePatch(built.data(), buildIndices);
+        if (!patchCache.store(key, built.data(), bytes, patchIndices.data(), indexCount))
+            cerr << "Failed to write tessellation cache " << patchCache.path(key) << endl;
+    }
+    const void* source = patchCacheHit ? cached.vertices() : built.data();
+
+    do {
+        void* vertices = patchStream.beginWrite(bytes);
+        if (!vertices) { cerr << "Failed to map the patch vertex buffer" << endl; return; }
+        if (useCache) memcpy(vertices, source, bytes);
+        else tessellatePatch(vertices, buildIndices);
+    } while (!patchStream.endWrite());
+
+    if (buildIndices) {
+        glBindVertexArray(patchVAOs[0]);
+        glBufferData(GL_ELEMENT_ARRAY_BUFFER, patchIndices.size() * sizeof(GLuint), patchIndices.data(), GL_STATIC_DRAW);
+        patchIndexLevel = n;
+        patchIndexTopology = patchTopology;
+    }
+    if (patchStream.slotResized() || patchSlotPacked[patchStream.slot()] != usePackedVertices) {
+        glBindVertexArray(patchVAOs[patchStream.slot()]);
+        glBindBuffer(GL_ARRAY_BUFFER, patchStream.buffer());
+        setPatchVertexFormat(usePackedVertices);
+        patchSlotPacked[patchStream.slot()] = usePackedVertices;
+    }
+}
+
+// Writes patchVertexCount vertices in the current format to `vertices` (the mapping, or system
+// memory for the cache) and, if asked, rebuilds patchIndices for the indexed grid.
+void tessellatePatch(void* vertices, bool buildIndices) {
+    // Grid points come from the Bernstein-table SIMD tessellator (bezier_simd.h): one
+    // evaluation per grid point, whole rows at a time, no pow(). Rows are split into bands
+    // across the thread pool; every band writes its own slice of the vertex buffer.
+    // Packed vertices go through patchGrid first, since the tessellator only writes floats.
+    int n = tessellationLevel;
+    patchTessellator.setLevel(n);
+    patchTessellator.setControlPoints(controlPoints.data());
+    int bands = glm::min(n, tessellationPool.size() * 4);
+    auto bandRows = [&](int band, int rows, int& begin, int& end) {
+        begin = band * rows / bands;
+        end = (band + 1) * rows / bands;
+    };
+
+    if (useIndexedPatch) {
+        // (N+1)x(N+1) shared vertices with analytic normals; the quads become indices,
+        // which only change with the level.
+        if (buildIndices) patchIndices.resize(patchIndexCount(n));
+        if (usePackedVertices) patchGrid.resize((size_t)(n + 1) * (n + 1) * 8);
+        tessellationPool.run(bands, [&](int band) {
+            int begin, end;
+            bandRows(band, n + 1, begin, end);
+            if (usePackedVertices) {
+                patchTessellator.tessellateRows(patchGrid.data(), 8, begin, end);
+                PackedVertex* packed = (PackedVertex*)vertices;
+                for (size_t k = (size_t)begin * (n + 1); k < (size_t)end * (n + 1); ++k) packPatchVertex(&patchGrid[k * 8], packed[k]);
+            } else {
+                patchTessellator.tessellateRows((float*)vertices, 8, begin, end);
+            }
+            if (!buildIndices) return;
+            bandRows(band, n, begin, end);
+            if (patchTopology == TriangleList) buildGridIndexRows(begin, end);
+            else buildGridStripRows(begin, end);
+        });
+    } else {
+        // Triangles of quad row i read grid rows i and i+1, so the grid has to be complete
+        // first. It stays in system memory: the triangle pass only ever writes to the output.
+        patchGrid.resize((size_t)(n + 1) * (n + 1) * 8);
+        tessellationPool.run(bands, [&](int band) {
+            int begin, end;
+            bandRows(band, n + 1, begin, end);
+            patchTessellator.tessellateRows(patchGrid.data(), 8, begin, end);
+        });
+        tessellationPool.run(bands, [&](int band) {
+            int begin, end;
+            bandRows(band, n, begin, end);
+            buildFlatTriangleRows(vertices, begin, end);
+        });
+    }
+}
+
+// Everything the streamed mesh's bytes depend on. The SIMD backend is included because its
+// rounding differs slightly between instruction sets.
+uint64_t patchCacheKey() {
+    int n = tessellationLevel, topology = useIndexedPatch ? (int)patchTopology : -1;
+    bool indexed = useIndexedPatch, packed = usePackedVertices, normals1010102 = packed && packedNormals1010102;
+    bool restart = indexed && patchTopology == TriangleStrips && usePrimitiveRestart;
+    uint64_t key = hashBytes(controlPoints.data(), controlPoints.size() * sizeof(vec3));
+    key = hashBytes(&n, sizeof(n), key);
+    key = hashBytes(&indexed, sizeof(indexed), key);
+    key = hashBytes(&packed, sizeof(packed), key);
+    key = hashBytes(&normals1010102, sizeof(normals1010102), key);
+    key = hashBytes(&topology, sizeof(topology), key);
+    key = hashBytes(&restart, sizeof(restart), key);
+    return hashBytes(kSimdName, strlen(kSimdName), key);
+}
+
+size_t patchVertexSize() {
+    return usePackedVertices ? sizeof(PackedVertex) : 8 * sizeof(float);
+}
+
+// Attribute pointers 0-2 for the buffer bound to GL_ARRAY_BUFFER.
+void setPatchVertexFormat(bool packed) {
+    if (!packed) {
+        glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 8 * sizeof(float), (void*)0); glEnableVertexAttribArray(0);
+        glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, 8 * sizeof(float), (void*)(3 * sizeof(float))); glEnableVertexAttribArray(1);
+        glVertexAttribPointer(2, 2, GL_FLOAT, GL_FALSE, 8 * sizeof(float), (void*)(6 * sizeof(float))); glEnableVertexAttribArray(2);
+        return;
+    }
+    GLsizei stride = sizeof(PackedVertex);
+    glVertexAttribPointer(0, 3, GL_UNSIGNED_SHORT, GL_TRUE, stride, (void*)offsetof(PackedVertex, position)); glEnableVertexAttribArray(0);
+    glVertexAttribPointer(1, 4, packedNormals1010102 ? GL_INT_2_10_10_10_REV : GL_BYTE, GL_TRUE, stride, (void*)offsetof(PackedVertex, normal)); glEnableVertexAttribArray(1);
+    glVertexAttribPointer(2, 2, GL_UNSIGNED_SHORT, GL_TRUE, stride, (void*)offsetof(PackedVertex, texCoords)); glEnableVertexAttribArray(2);
+}
+
+// Bounding box of the control points as offset and per-axis scale, kept non-zero so flat axes still pack.
+void updatePatchBounds() {
+    vec3 lo = controlPoints[0], hi = controlPoints[0];
+    for (const vec3& p : controlPoints) { lo = glm::min(lo, p); hi = glm::max(hi, p); }
+    patchBoundsMin = lo;
+    patchBoundsScale = glm::max(hi - lo, vec3(1e-6f));
+}
+
+// v is one 8-float vertex: position, normal, uv.
+void packPatchVertex(const float* v, PackedVertex& out) {
+    for (int k = 0; k < 3; ++k) {
+        float t = glm::clamp((v[k] - patchBoundsMin[k]) / patchBoundsScale[k], 0.0f, 1.0f);
+        out.position[k] = (uint16_t)(t * 65535.0f + 0.5f);
+    }
+    out.pad = 0;
+    out.normal = packNormal(vec3(v[3], v[4], v[5]));
+    out.texCoords[0] = (uint16_t)(glm::clamp(v[6], 0.0f, 1.0f) * 65535.0f + 0.5f);
+    out.texCoords[1] = (uint16_t)(glm::clamp(v[7], 0.0f, 1.0f) * 65535.0f + 0.5f);
+}
+
+// Unit normal as 10:10:10:2 signed normalized (x in the low bits, w = 0), or four signed bytes.
+uint32_t packNormal(const vec3& n) {
+    if (packedNormals1010102) {
+        uint32_t x = (uint32_t)(int)round(glm::clamp(n.x, -1.0f, 1.0f) * 511.0f) & 0x3FF;
+        uint32_t y = (uint32_t)(int)round(glm::clamp(n.y, -1.0f, 1.0f) * 511.0f) & 0x3FF;
+        uint32_t z = (uint32_t)(int)round(glm::clamp(n.z, -1.0f, 1.0f) * 511.0f) & 0x3FF;
+        return x | y << 10 | z << 20;
+    }
+    int8_t bytes[4] = { (int8_t)round(glm::clamp(n.x, -1.0f, 1.0f) * 127.0f),
+                        (int8_t)round(glm::clamp(n.y, -1.0f, 1.0f) * 127.0f),
+                        (int8_t)round(glm::clamp(n.z, -1.0f, 1.0f) * 127.0f), 0 };
+    uint32_t word;
+    memcpy(&word, bytes, sizeof(word));
+    return word;
+}
+
+// Flat-shaded triangle list for quad rows [rowBegin, rowEnd), written in place: quad (i,j)
+// owns the 6 vertices starting at (i * N + j) * 6, as floats or PackedVertex.
+void buildFlatTriangleRows(void* out, int rowBegin, int rowEnd) {
+    int n = tessellationLevel;
+    for (int i = rowBegin; i < rowEnd; ++i) {
+        for (int j = 0; j < n; ++j) {
+            const float* g00 = &patchGrid[(size_t)(i * (n + 1) + j) * 8];
+            const float* g01 = g00 + 8;
+            const float* g10 = g00 + (n + 1) * 8;
+            const float* g11 = g10 + 8;
+            float u0 = g00[6], v0 = g00[7], u1 = g11[6], v1 = g11[7];
+            vec3 p00(g00[0], g00[1], g00[2]); vec3 p10(g10[0], g10[1], g10[2]);
+            vec3 p01(g01[0], g01[1], g01[2]); vec3 p11(g11[0], g11[1], g11[2]);
             vec3 n1 = normalize(cross(p10 - p00, p01 - p00));
             vec3 n2 = normalize(cross(p01 - p11, p10 - p11));
-            
-            patchVertices.insert(patchVertices.end(), {p00.x,p00.y,p00.z, n1.x,n1.y,n1.z, u0, v0});
-            patchVertices.insert(patchVertices.end(), {p10.x,p10.y,p10.z, n1.x,n1.y,n1.z, u1, v0});
-            patchVertices.insert(patchVertices.end(), {p01.x,p01.y,p01.z, n1.x,n1.y,n1.z, u0, v1});
-            
-            patchVertices.insert(patchVertices.end(), {p10.x,p10.y,p10.z, n2.x,n2.y,n2.z, u1, v0});
-            patchVertices.insert(patchVertices.end(), {p11.x,p11.y,p11.z, n2.x,n2.y,n2.z, u1, v1});
-            patchVertices.insert(patchVertices.end(), {p01.x,p01.y,p01.z, n2.x,n2.y,n2.z, u0, v1});
+
+            float quad[48] = {
+                p00.x,p00.y,p00.z, n1.x,n1.y,n1.z, u0, v0,
+                p10.x,p10.y,p10.z, n1.x,n1.y,n1.z, u1, v0,
+                p01.x,p01.y,p01.z, n1.x,n1.y,n1.z, u0, v1,
+                p10.x,p10.y,p10.z, n2.x,n2.y,n2.z, u1, v0,
+                p11.x,p11.y,p11.z, n2.x,n2.y,n2.z, u1, v1,
+                p01.x,p01.y,p01.z, n2.x,n2.y,n2.z, u0, v1,
+            };
+            size_t first = (size_t)(i * n + j) * 6;
+            if (usePackedVertices) {
+                for (int k = 0; k < 6; ++k) packPatchVertex(quad + k * 8, ((PackedVertex*)out)[first + k]);
+            } else {
+                copy(quad, quad + 48, (float*)out + first * 8);
+            }
         }
     }
-    glBindVertexArray(patchVAO);
-    glBindBuffer(GL_ARRAY_BUFFER, patchVBO);
-    glBufferData(GL_ARRAY_BUFFER, patchVertices.size() * sizeof(float), patchVertices.data(), GL_DYNAMIC_DRAW);
-    glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 8 * sizeof(float), (void*)0); glEnableVertexAttribArray(0);
-    glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, 8 * sizeof(float), (void*)(3 * sizeof(float))); glEnableVertexAttribArray(1);
-    glVertexAttribPointer(2, 2, GL_FLOAT, GL_FALSE, 8 * sizeof(float), (void*)(6 * sizeof(float))); glEnableVertexAttribArray(2);
 }
 
-// --- Full Helper Function Implementations ---
-vec3 evaluateBezierCurve(const vec3& p0, const vec3& p1, const vec3& p2, const vec3& p3, float t) {
-    float one_minus_t = 1.0f - t;
-    return pow(one_minus_t, 3.0f) * p0 + 3.0f * pow(one_minus_t, 2.0f) * t * p1 + 3.0f * one_minus_t * pow(t, 2.0f) * p2 + pow(t, 3.0f) * p3;
+// Index rows [rowBegin, rowEnd) of the shared-vertex grid, quad (i,j) at (i * N + j) * 6.
+void buildGridIndexRows(int rowBegin, int rowEnd) {
+    int n = tessellationLevel;
+    for (int i = rowBegin; i < rowEnd; ++i) {
+        for (int j = 0; j < n; ++j) {
+            GLuint i00 = i * (n + 1) + j, i01 = i00 + 1, i10 = i00 + (n + 1), i11 = i10 + 1;
+            GLuint* quad = &patchIndices[(size_t)(i * n + j) * 6];
+            quad[0] = i00; quad[1] = i10; quad[2] = i01;
+            quad[3] = i10; quad[4] = i11; quad[5] = i01;
+        }
+    }
+}
+
+// Strip rows [rowBegin, rowEnd): row i alternates grid rows i and i+1, (i,0) (i+1,0) (i,1) ...,
+// which yields the same triangles and winding as buildGridIndexRows, then ends with its join.
+void buildGridStripRows(int rowBegin, int rowEnd) {
+    int n = tessellationLevel;
+    size_t rowLength = patchIndexCount(n) / n;
+    for (int i = rowBegin; i < rowEnd; ++i) {
+        GLuint* row = &patchIndices[(size_t)i * rowLength];
+        for (int j = 0; j <= n; ++j) {
+            row[2 * j] = i * (n + 1) + j;
+            row[2 * j + 1] = (i + 1) * (n + 1) + j;
+        }
+        if (usePrimitiveRestart) {
+            row[2 * (n + 1)] = patchRestartIndex;
+        } else {
+            // Repeat this row's last vertex and the next row's first. The row length is even,
+            // so the next strip starts on an even index and keeps its winding.
+            row[2 * (n + 1)] = row[2 * (n + 1) - 1];
+            row[2 * (n + 1) + 1] = (i + 1) * (n + 1);
+        }
+    }
+}
+
+size_t patchIndexCount(int n) {
+    if (patchTopology == TriangleList) return (size_t)n * n * 6;
+    return (size_t)n * (2 * (n + 1) + (usePrimitiveRestart ? 1 : 2));
 }
-vec3 evaluateBezierPatch(float u, float v) {
-    vec3 v_curve_points[4];
-    for (int i = 0; i < 4; ++i) {
-        v_curve_points[i] = evaluateBezierCurve(controlPoints[i * 4 + 0], controlPoints[i * 4 + 1], controlPoints[i * 4 + 2], controlPoints[i * 4 + 3], u);
+
+// Draws the indexed grid a fixed number of times per topology, timed with GL_TIME_ELAPSED
+// queries (or glFinish and the wall clock without ARB_timer_query), and keeps the faster one.
+// Always through patchShader with the current camera, whichever path the frame loop is on.
+void benchmarkPatchTopologies() {
+    const int draws = 50;
+    bool timerQuery = GLVersion.major > 3 || (GLVersion.major == 3 && GLVersion.minor >= 3) ||
+                      glfwExtensionSupported("GL_ARB_timer_query");
+    bool wasIndexed = useIndexedPatch;
+    useIndexedPatch = true;
+    double milliseconds[2];
+    for (int t = 0; t < 2; ++t) {
+        patchTopology = (PatchTopology)t;
+        updatePatchGeometry();
+        GLenum mode = patchTopology == TriangleList ? GL_TRIANGLES : GL_TRIANGLE_STRIP;
+        glUseProgram(patchShader);
+        setCameraUniforms(patchShader);
+        setStreamedMeshUniforms(); // packed bounds change with each rebuild
+        glBindVertexArray(patchVAOs[patchStream.slot()]);
+        glDrawElements(mode, patchIndices.size(), GL_UNSIGNED_INT, 0); // warm-up
+        glFinish();
+
+        GLuint query = 0;
+        double start = glfwGetTime();
+        if (timerQuery) { glGenQueries(1, &query); glBeginQuery(GL_TIME_ELAPSED, query); }
+        for (int d = 0; d < draws; ++d) glDrawElements(mode, patchIndices.size(), GL_UNSIGNED_INT, 0);
+        if (timerQuery) {
+            glEndQuery(GL_TIME_ELAPSED);
+            GLuint64 nanoseconds = 0;
+            glGetQueryObjectui64v(query, GL_QUERY_RESULT, &nanoseconds);
+            glDeleteQueries(1, &query);
+            milliseconds[t] = nanoseconds / 1e6 / draws;
+        } else {
+            glFinish();
+            milliseconds[t] = (glfwGetTime() - start) * 1000.0 / draws;
+        }
+        patchStream.fence();
+        cout << "Topology benchmark, level " << tessellationLevel << ": "
+             << (patchTopology == TriangleList ? "triangle list   " : "triangle strips ") << patchIndices.size() << " indices, "
+             << milliseconds[t] << " ms/draw" << (timerQuery ? " (GPU timer)" : " (glFinish)") << endl;
     }
-    return evaluateBezierCurve(v_curve_points[0], v_curve_points[1], v_curve_points[2], v_curve_points[3], v);
+    patchTopology = milliseconds[TriangleStrips] < milliseconds[TriangleList] ? TriangleStrips : TriangleList;
+    useIndexedPatch = wasIndexed;
+    updatePatchGeometry();
+    cout << "Using " << (patchTopology == TriangleList ? "triangle list" : "triangle strips") << " for the indexed grid" << endl;
 }
+
+// Sets the orbit camera's transforms and the lighting on the bound program; returns the eye.
+vec3 setCameraUniforms(GLuint shader) {
+    float camX = camDist * cos(radians(camAngle)) * cos(radians(camPitch));
+    float camY = camDist * sin(radians(camPitch));
+    float camZ = camDist * sin(radians(camAngle)) * cos(radians(camPitch));
+    vec3 camPos = vec3(camX, camY, camZ);
+    mat4 view = lookAt(camPos, vec3(0.0), vec3(0.0, 1.0, 0.0));
+    mat4 projection = perspective(radians(45.0f), (float)windowWidth / (float)windowHeight, 0.1f, 100.0f);
+    glUniformMatrix4fv(glGetUniformLocation(shader, "model"), 1, GL_FALSE, value_ptr(mat4(1.0f)));
+    glUniformMatrix4fv(glGetUniformLocation(shader, "view"), 1, GL_FALSE, value_ptr(view));
+    glUniformMatrix4fv(glGetUniformLocation(shader, "projection"), 1, GL_FALSE, value_ptr(projection));
+    glUniform3fv(glGetUniformLocation(shader, "viewPos"), 1, value_ptr(camPos));
+    glUniform3f(glGetUniformLocation(shader, "lightPos"), 0.0f, 2.0f, 5.0f);
+    glUniform1f(glGetUniformLocation(shader, "shininess"), 256.0f);
+    return camPos;
+}
+
+// No morph, and the packed-position decode for the streamed mesh's current format.
+void setStreamedMeshUniforms() {
+    glUniform1f(glGetUniformLocation(patchShader, "morph"), 1.0f);
+    vec3 offset = usePackedVertices ? patchBoundsMin : vec3(0.0f), scale = usePackedVertices ? patchBoundsScale : vec3(1.0f);
+    glUniform3fv(glGetUniformLocation(patchShader, "positionOffset"), 1, value_ptr(offset));
+    glUniform3fv(glGetUniformLocation(patchShader, "positionScale"), 1, value_ptr(scale));
+}
+
+// Continuous level that gives the patch's bounding sphere about one segment per
+// lodPixelsPerSegment pixels of projected diameter.
+float lodLevelForView(const vec3& camPos) {
+    vec3 center(0.0f);
+    for (const vec3& p : controlPoints) center += p;
+    center /= (float)controlPoints.size();
+    float radius = 0.0f;
+    for (const vec3& p : controlPoints) radius = glm::max(radius, length(p - center));
+
+    float distance = length(camPos - center);
+    if (distance <= radius) return (float)lodMaxLevel;
+    float pixels = 2.0f * radius * windowHeight / (2.0f * distance * tan(radians(45.0f) * 0.5f));
+    return glm::clamp(pixels / lodPixelsPerSegment, (float)lodMinLevel, (float)lodMaxLevel);
+}
+
+// Returns the cached mesh for `level`, building it over the least recently used slot on a miss.
+LodMesh& acquireLodMesh(int level) {
+    ++lodFrame;
+    LodMesh* victim = &lodCache[0];
+    for (LodMesh& mesh : lodCache) {
+        if (mesh.level == level) { mesh.lastUsed = lodFrame; return mesh; }
+        if (mesh.lastUsed < victim->lastUsed) victim = &mesh;
+    }
+    double start = glfwGetTime();
+    buildLodMesh(*victim, level);
+    victim->lastUsed = lodFrame;
+    cout << "LOD cache miss: built level " << level << " in " << (glfwGetTime() - start) * 1000.0 << " ms" << endl;
+    return *victim;
+}
+
+// Indexed grid at `level` (even), 14 floats per vertex: position, normal, uv, then the position
+// and normal the vertex has on the level/2 grid. Vertices on even grid lines are shared with
+// that grid; the rest sit halfway along a coarse edge, or on the diagonal of a coarse quad,
+// which the triangulation (i00,i10,i01 / i10,i11,i01) splits from (i+1,j-1) to (i-1,j+1).
+void buildLodMesh(LodMesh& mesh, int level) {
+    const int n = level, stride = 14;
+    lodTessellator.setLevel(n);
+    lodTessellator.setControlPoints(controlPoints.data());
+    vector<float> grid((size_t)(n + 1) * (n + 1) * 8), vertices((size_t)(n + 1) * (n + 1) * stride);
+    vector<GLuint> indices((size_t)n * n * 6);
+    int bands = glm::min(n, tessellationPool.size() * 4);
+    tessellationPool.run(bands, [&](int band) {
+        lodTessellator.tessellateRows(grid.data(), 8, band * (n + 1) / bands, (band + 1) * (n + 1) / bands);
+    });
+    tessellationPool.run(bands, [&](int band) {
+        for (int i = band * (n + 1) / bands; i < (band + 1) * (n + 1) / bands; ++i) {
+            for (int j = 0; j <= n; ++j) {
+                int ia = i, ja = j, ib = i, jb = j;
+                if (i % 2 && j % 2) { ia = i + 1; ja = j - 1; ib = i - 1; jb = j + 1; }
+                else if (i % 2) { ia = i - 1; ib = i + 1; }
+                else if (j % 2) { ja = j - 1; jb = j + 1; }
+                const float* v = &grid[(size_t)(i * (n + 1) + j) * 8];
+                const float* a = &grid[(size_t)(ia * (n + 1) + ja) * 8];
+                const float* b = &grid[(size_t)(ib * (n + 1) + jb) * 8];
+                float* out = &vertices[(size_t)(i * (n + 1) + j) * stride];
+                copy(v, v + 8, out);
+                for (int k = 0; k < 6; ++k) out[8 + k] = 0.5f * (a[k] + b[k]);
+            }
+        }
+        for (int i = band * n / bands; i < (band + 1) * n / bands; ++i) {
+            for (int j = 0; j < n; ++j) {
+                GLuint i00 = i * (n + 1) + j, i01 = i00 + 1, i10 = i00 + (n + 1), i11 = i10 + 1;
+                GLuint* quad = &indices[(size_t)(i * n + j) * 6];
+                quad[0] = i00; quad[1] = i10; quad[2] = i01;
+                quad[3] = i10; quad[4] = i11; quad[5] = i01;
+            }
+        }
+    });
+
+    if (!mesh.vao) {
+        glGenVertexArrays(1, &mesh.vao);
+        glGenBuffers(1, &mesh.vbo);
+        glGenBuffers(1, &mesh.ebo);
+    }
+    mesh.level = level;
+    mesh.indexCount = indices.size();
+    glBindVertexArray(mesh.vao);
+    glBindBuffer(GL_ARRAY_BUFFER, mesh.vbo);
+    glBufferData(GL_ARRAY_BUFFER, vertices.size() * sizeof(float), vertices.data(), GL_STATIC_DRAW);
+    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, mesh.ebo);
+    glBufferData(GL_ELEMENT_ARRAY_BUFFER, indices.size() * sizeof(GLuint), indices.data(), GL_STATIC_DRAW);
+    glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, stride * sizeof(float), (void*)0); glEnableVertexAttribArray(0);
+    glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, stride * sizeof(float), (void*)(3 * sizeof(float))); glEnableVertexAttribArray(1);
+    glVertexAttribPointer(2, 2, GL_FLOAT, GL_FALSE, stride * sizeof(float), (void*)(6 * sizeof(float))); glEnableVertexAttribArray(2);
+    glVertexAttribPointer(3, 3, GL_FLOAT, GL_FALSE, stride * sizeof(float), (void*)(8 * sizeof(float))); glEnableVertexAttribArray(3);
+    glVertexAttribPointer(4, 3, GL_FLOAT, GL_FALSE, stride * sizeof(float), (void*)(11 * sizeof(float))); glEnableVertexAttribArray(4);
+}
+
+// --- Full Helper Function Implementations ---
 void framebuffer_size_callback(GLFWwindow* /*window*/, int width, int height) {
     glViewport(0, 0, width, height); windowWidth = width; windowHeight = height;
 }
@@ -170,10 +725,29 @@ GLuint makeProgram(const string& vPath, const string& fPath) {
     glBindAttribLocation(prog, 0, "aPos");
     glBindAttribLocation(prog, 1, "aNormal");
     glBindAttribLocation(prog, 2, "aTexCoords");
+    glBindAttribLocation(prog, 3, "aMorphPos");
+    glBindAttribLocation(prog, 4, "aMorphNormal");
     glLinkProgram(prog);
     GLint ok; glGetProgramiv(prog, GL_LINK_STATUS, &ok);
     if (!ok) { char log[1024]; glGetProgramInfoLog(prog, 1024, NULL, log); cerr << "Link Error: " << log << endl; }
     glDeleteShader(v); glDeleteShader(f);
     return prog;
 }
+GLuint makeTessellationProgram(const string& vPath, const string& tcPath, const string& tePath, const string& fPath) {
+    string vCode = loadShaderFromFile(vPath); string tcCode = loadShaderFromFile(tcPath);
+    string teCode = loadShaderFromFile(tePath); string fCode = loadShaderFromFile(fPath);
+    if(vCode.empty() || tcCode.empty() || teCode.empty() || fCode.empty()){ cerr << "Shader file(s) not found or empty." << endl; return 0; }
+    GLuint v = compileShader(GL_VERTEX_SHADER, vCode.c_str());
+    GLuint tc = compileShader(GL_TESS_CONTROL_SHADER, tcCode.c_str());
+    GLuint te = compileShader(GL_TESS_EVALUATION_SHADER, teCode.c_str());
+    GLuint f = compileShader(GL_FRAGMENT_SHADER, fCode.c_str());
+    GLuint prog = glCreateProgram();
+    glAttachShader(prog, v); glAttachShader(prog, tc); glAttachShader(prog, te); glAttachShader(prog, f);
+    glBindAttribLocation(prog, 0, "aPos");
+    glLinkProgram(prog);
+    GLint ok; glGetProgramiv(prog, GL_LINK_STATUS, &ok);
+    if (!ok) { char log[1024]; glGetProgramInfoLog(prog, 1024, NULL, log); cerr << "Link Error: " << log << endl; glDeleteProgram(prog); prog = 0; }
+    glDeleteShader(v); glDeleteShader(tc); glDeleteShader(te); glDeleteShader(f);
+    return prog;
+}
 // --- END OF MODIFIED FILE ---
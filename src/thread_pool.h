@@ -0,0 +1,101 @@
+// Small fixed-size thread pool for data-parallel loops such as row-band tessellation.
+//
+// run(count, task) hands out task indices 0..count-1 to the workers and to the calling
+// thread, and returns once every index has been processed. Worker count defaults to the
+// hardware concurrency and can be overridden with the TESS_THREADS environment variable.
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdlib>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+class ThreadPool {
+public:
+    explicit ThreadPool(unsigned threadCount = defaultThreadCount()) {
+        for (unsigned t = 1; t < threadCount; ++t) workers.emplace_back(&ThreadPool::workerLoop, this);
+    }
+
+    ~ThreadPool() {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            stopping = true;
+        }
+        wake.notify_all();
+        for (std::thread& worker : workers) worker.join();
+    }
+
+    ThreadPool(const ThreadPool&) = delete;
+    ThreadPool& operator=(const ThreadPool&) = delete;
+
+    // Threads taking part in run(), including the caller.
+    int size() const { return (int)workers.size() + 1; }
+
+    void run(int taskCount, const std::function<void(int)>& task) {
+        if (workers.empty() || taskCount <= 1) {
+            for (int t = 0; t < taskCount; ++t) task(t);
+            return;
+        }
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            job = &task;
+            jobCount = taskCount;
+            nextTask = 0;
+            busyWorkers = workers.size();
+            ++generation;
+        }
+        wake.notify_all();
+        drain(task, taskCount);
+
+        std::unique_lock<std::mutex> lock(mutex);
+        done.wait(lock, [this] { return busyWorkers == 0; });
+        job = nullptr;
+    }
+
+    static unsigned defaultThreadCount() {
+        if (const char* env = std::getenv("TESS_THREADS")) {
+            int requested = std::atoi(env);
+            if (requested > 0) return requested;
+        }
+        unsigned hw = std::thread::hardware_concurrency();
+        return hw ? hw : 1;
+    }
+
+private:
+    void drain(const std::function<void(int)>& task, int taskCount) {
+        for (int t = nextTask++; t < taskCount; t = nextTask++) task(t);
+    }
+
+    void workerLoop() {
+        unsigned seenGeneration = 0;
+        for (;;) {
+            const std::function<void(int)>* task;
+            int taskCount;
+            {
+                std::unique_lock<std::mutex> lock(mutex);
+                wake.wait(lock, [&] { return stopping || generation != seenGeneration; });
+                if (stopping) return;
+                seenGeneration = generation;
+                task = job;
+                taskCount = jobCount;
+            }
+            drain(*task, taskCount);
+            {
+                std::lock_guard<std::mutex> lock(mutex);
+                if (--busyWorkers == 0) done.notify_one();
+            }
+        }
+    }
+
+    std::vector<std::thread> workers;
+    std::mutex mutex;
+    std::condition_variable wake, done;
+    const std::function<void(int)>* job = nullptr;
+    int jobCount = 0, busyWorkers = 0;
+    unsigned generation = 0;
+    bool stopping = false;
+    std::atomic<int> nextTask{0};
+};